@@ -0,0 +1,167 @@
+#ifndef ADAPTIVE_TOLERANCE_HPP
+#define ADAPTIVE_TOLERANCE_HPP
+
+#include "IncludesFile.hpp"
+#include <functional>
+using namespace dealii;
+
+// Adaptive tolerances of the outer solve and of the inner solves of the
+// block preconditioners (Eisenstat-Walker).
+//
+// The outer solve is asked to reduce its initial residual by a forcing term
+// eta. Within the Picard/Newton iterations eta follows the Eisenstat-Walker
+// choice 2, eta_k = gamma (|F_k| / |F_{k-1}|)^alpha, where F is the
+// nonlinear residual. Between semi-implicit time steps, the nonlinear
+// residual is replaced by the relative change of the solution over the last
+// step, eta_n = gamma |u^n - u^{n-1}| / |u^n|: the linear system is not
+// solved far below what the time step changes. In both cases the
+// safeguard of Eisenstat-Walker prevents eta from dropping too fast, and eta
+// is kept in [eta_min, eta_max].
+//
+// The inner tolerance follows the current outer residual (relaxation of
+// inexact Krylov methods, Simoncini-Szyld): at outer iteration j it is
+// inner_factor * eta * |r_0| / |r_j|, kept in [inner_min, inner_max]. The
+// first preconditioner applications are as accurate as the reduction asked
+// to the outer solve, the later ones, which contribute less to the final
+// residual, get looser.
+class AdaptiveTolerance
+{
+public:
+  struct AdditionalData
+  {
+    AdditionalData(const double &eta_initial = 1e-6,
+                   const double &eta_min = 1e-8,
+                   const double &eta_max = 1e-1,
+                   const double &gamma = 0.9,
+                   const double &alpha = 0.5 * (1.0 + std::sqrt(5.0)),
+                   const double &inner_factor = 1.0,
+                   const double &inner_min = 1e-3,
+                   const double &inner_max = 1e-1)
+      : eta_initial(eta_initial)
+      , eta_min(eta_min)
+      , eta_max(eta_max)
+      , gamma(gamma)
+      , alpha(alpha)
+      , inner_factor(inner_factor)
+      , inner_min(inner_min)
+      , inner_max(inner_max)
+    {
+    }
+
+    double eta_initial;
+    double eta_min;
+    double eta_max;
+    double gamma;
+    double alpha;
+    double inner_factor;
+    double inner_min;
+    double inner_max;
+  };
+
+  AdaptiveTolerance(const AdditionalData &data_ = AdditionalData())
+    : data(data_)
+    , eta(data_.eta_initial)
+  {
+    AssertThrow(data.eta_min > 0.0 && data.eta_min <= data.eta_max && data.eta_max < 1.0,
+                ExcMessage("The forcing term must be in (0, 1)."));
+    AssertThrow(data.inner_min > 0.0 && data.inner_min <= data.inner_max,
+                ExcMessage("Invalid bounds of the inner tolerance."));
+  }
+
+  // Start the iterations of a nonlinear solve.
+  void
+  start_nonlinear_solve()
+  {
+    previous_residual_norm = 0.0;
+  }
+
+  // Update eta from the nonlinear residual of the current iterate.
+  void
+  update_from_nonlinear_residual(const double &residual_norm)
+  {
+    if (previous_residual_norm > 0.0)
+      set_forcing_term(data.gamma *
+                       std::pow(residual_norm / previous_residual_norm, data.alpha));
+    previous_residual_norm = residual_norm;
+  }
+
+  // Update eta from the relative change of the solution over the last time
+  // step.
+  void
+  update_from_solution_change(const double &relative_change)
+  {
+    set_forcing_term(data.gamma * relative_change);
+  }
+
+  // Absolute tolerance of the outer solve, given its initial residual.
+  double
+  outer_tolerance(const double &initial_residual_norm) const
+  {
+    return eta * initial_residual_norm;
+  }
+
+  // Relative tolerance of the inner solves, given the relative residual
+  // |r_j| / |r_0| of the outer solve.
+  double
+  inner_tolerance(const double &residual_ratio = 1.0) const
+  {
+    const double relaxation = residual_ratio > 0.0 ? 1.0 / residual_ratio : 1.0;
+    return std::clamp(data.inner_factor * eta * relaxation, data.inner_min, data.inner_max);
+  }
+
+  double
+  forcing_term() const
+  {
+    return eta;
+  }
+
+protected:
+  // Safeguarded and clamped update of eta.
+  void
+  set_forcing_term(const double &eta_new)
+  {
+    const double safeguard = data.gamma * std::pow(eta, data.alpha);
+    const double eta_safe = (safeguard > 0.1) ? std::max(eta_new, safeguard) : eta_new;
+    eta = std::clamp(eta_safe, data.eta_min, data.eta_max);
+  }
+
+  const AdditionalData data;
+
+  // Current forcing term.
+  double eta;
+
+  // Nonlinear residual of the previous iterate (0 at the first iterate).
+  double previous_residual_norm = 0.0;
+};
+
+// Solver control of the outer solve which passes the relative residual
+// |r_j| / |r_0| of each iteration to a callback, to update the inner
+// tolerance of the preconditioner before its next application.
+class ResidualMonitorControl : public SolverControl
+{
+public:
+  ResidualMonitorControl(const unsigned int &maxiter,
+                         const double &tolerance,
+                         const bool &log_history)
+    : SolverControl(maxiter, tolerance, log_history)
+  {
+  }
+
+  virtual State
+  check(const unsigned int step, const double check_value) override
+  {
+    if (step == 0)
+      initial_residual = check_value;
+    else if (on_residual_ratio && initial_residual > 0.0)
+      on_residual_ratio(check_value / initial_residual);
+    return SolverControl::check(step, check_value);
+  }
+
+  // Called at each iteration after the first one (empty: no monitoring).
+  std::function<void(const double &)> on_residual_ratio;
+
+protected:
+  double initial_residual = 0.0;
+};
+
+#endif
@@ -0,0 +1,627 @@
+#ifndef ASSEMBLY_KERNELS_HPP
+#define ASSEMBLY_KERNELS_HPP
+
+#include "IncludesFile.hpp"
+
+using namespace dealii;
+
+// Number of DoFs of the scalar P_k element on a triangle (dim = 2) or on a
+// tetrahedron (dim = 3).
+constexpr unsigned int
+n_simplex_dofs(const int dim, const unsigned int degree)
+{
+  return (dim == 2) ? (degree + 1) * (degree + 2) / 2
+                    : (degree + 1) * (degree + 2) * (degree + 3) / 6;
+}
+
+// Data of a batch of cells, one cell per SIMD lane: shape functions, current
+// velocity, forcing term and JxW at the quadrature points. The batch is
+// filled lane by lane from FEValues and then assembled at once with
+// vectorized arithmetic.
+template <int dim>
+class CellBatch
+{
+public:
+  using Number = VectorizedArray<double>;
+
+  static constexpr unsigned int n_lanes = Number::size();
+
+  void
+  reinit(const unsigned int &dofs_per_cell_, const unsigned int &n_q_)
+  {
+    dofs_per_cell = dofs_per_cell_;
+    n_q = n_q_;
+
+    phi_u.resize(n_q * dofs_per_cell);
+    grad_phi_u.resize(n_q * dofs_per_cell);
+    velocity.resize(n_q);
+    velocity_divergence.resize(n_q);
+    forcing.resize(n_q);
+    JxW.resize(n_q);
+  }
+
+  // Copy the data of the cell currently in fe_values into the given lane.
+  void
+  fill_lane(const FEValues<dim> &fe_values,
+            const unsigned int &lane,
+            const std::vector<Tensor<1, dim>> &velocity_values,
+            const std::vector<double> &velocity_divergence_values,
+            const std::vector<Tensor<1, dim>> &forcing_values)
+  {
+    const FEValuesExtractors::Vector velocity_extractor(0);
+
+    for (unsigned int q = 0; q < n_q; ++q)
+    {
+      for (unsigned int k = 0; k < dofs_per_cell; ++k)
+      {
+        const Tensor<1, dim> value = fe_values[velocity_extractor].value(k, q);
+        const Tensor<2, dim> gradient = fe_values[velocity_extractor].gradient(k, q);
+
+        for (unsigned int d = 0; d < dim; ++d)
+        {
+          phi_u[q * dofs_per_cell + k][d][lane] = value[d];
+          for (unsigned int e = 0; e < dim; ++e)
+            grad_phi_u[q * dofs_per_cell + k][d][e][lane] = gradient[d][e];
+        }
+      }
+
+      for (unsigned int d = 0; d < dim; ++d)
+      {
+        velocity[q][d][lane] = velocity_values[q][d];
+        forcing[q][d][lane] = forcing_values[q][d];
+      }
+      velocity_divergence[q][lane] = velocity_divergence_values[q];
+      JxW[q][lane] = fe_values.JxW(q);
+    }
+  }
+
+  unsigned int dofs_per_cell = 0;
+
+  unsigned int n_q = 0;
+
+  // Shape functions, stored as [q * dofs_per_cell + k].
+  std::vector<Tensor<1, dim, Number>> phi_u;
+  std::vector<Tensor<2, dim, Number>> grad_phi_u;
+
+  std::vector<Tensor<1, dim, Number>> velocity;
+  std::vector<Number> velocity_divergence;
+  std::vector<Tensor<1, dim, Number>> forcing;
+  std::vector<Number> JxW;
+};
+
+// Local assembly kernels for a fixed pair of velocity/pressure degrees. The
+// number of DoFs per cell is a compile time constant, so the local matrices
+// are fixed-size arrays and the loops over the DoFs have constexpr bounds,
+// which lets the compiler unroll and vectorize them. The shape functions are
+// read once per quadrature point from FEValues and then reused for every
+// (i, j) pair.
+template <int dim, unsigned int degree_velocity, unsigned int degree_pressure>
+class AssemblyKernel
+{
+public:
+  static constexpr unsigned int dofs_per_cell =
+      dim * n_simplex_dofs(dim, degree_velocity) +
+      n_simplex_dofs(dim, degree_pressure);
+
+  template <typename Number>
+  using LocalMatrix = std::array<std::array<Number, dofs_per_cell>, dofs_per_cell>;
+
+  template <typename Number>
+  using LocalVector = std::array<Number, dofs_per_cell>;
+
+  // Shape functions (and their derivatives) at one quadrature point.
+  template <typename Number>
+  struct ShapeValues
+  {
+    std::array<Tensor<1, dim, Number>, dofs_per_cell> phi_u;
+    std::array<Tensor<2, dim, Number>, dofs_per_cell> grad_phi_u;
+    std::array<Number, dofs_per_cell> div_phi_u;
+    std::array<Number, dofs_per_cell> phi_p;
+  };
+
+  // Read the shape functions at the quadrature point q.
+  static void
+  fill_shape_values(const FEValues<dim> &fe_values,
+                    const unsigned int &q,
+                    ShapeValues<double> &shape)
+  {
+    const FEValuesExtractors::Vector velocity(0);
+    const FEValuesExtractors::Scalar pressure(dim);
+
+    for (unsigned int k = 0; k < dofs_per_cell; ++k)
+    {
+      shape.phi_u[k] = fe_values[velocity].value(k, q);
+      shape.grad_phi_u[k] = fe_values[velocity].gradient(k, q);
+      shape.div_phi_u[k] = fe_values[velocity].divergence(k, q);
+      shape.phi_p[k] = fe_values[pressure].value(k, q);
+    }
+  }
+
+  // Convective term (with Temam stabilization) and right-hand side
+  // contributions of one quadrature point.
+  template <typename Number>
+  static void
+  convection_kernel(const Tensor<1, dim, Number> *phi_u,
+                    const Tensor<2, dim, Number> *grad_phi_u,
+                    const Tensor<1, dim, Number> &velocity,
+                    const Number &velocity_divergence,
+                    const Tensor<1, dim, Number> &forcing,
+                    const Number &JxW,
+                    const double &deltat,
+                    LocalMatrix<Number> &convection_matrix,
+                    LocalVector<Number> &rhs)
+  {
+    // (grad(phi_j) u + 0.5 div(u) phi_j) JxW does not depend on i.
+    std::array<Tensor<1, dim, Number>, dofs_per_cell> transport;
+    for (unsigned int j = 0; j < dofs_per_cell; ++j)
+      transport[j] = (grad_phi_u[j] * velocity +
+                      0.5 * velocity_divergence * phi_u[j]) * JxW;
+
+    const Tensor<1, dim, Number> rhs_integrand =
+        (velocity / deltat + forcing) * JxW;
+
+    for (unsigned int i = 0; i < dofs_per_cell; ++i)
+    {
+      for (unsigned int j = 0; j < dofs_per_cell; ++j)
+        convection_matrix[i][j] += phi_u[i] * transport[j];
+
+      rhs[i] += phi_u[i] * rhs_integrand;
+    }
+  }
+
+  // Viscous (with the grad-div term gamma (div u, div v)), mass, pressure
+  // coupling and pressure mass contributions of one quadrature point. The
+  // symmetric matrices are only computed for j <= i.
+  static void
+  static_kernel(const ShapeValues<double> &shape,
+                const double &nu,
+                const double &deltat,
+                const double &grad_div,
+                const double &JxW,
+                LocalMatrix<double> &matrix,
+                LocalMatrix<double> &mass_matrix,
+                LocalMatrix<double> &stiffness_matrix,
+                LocalMatrix<double> &pressure_mass_matrix)
+  {
+    for (unsigned int i = 0; i < dofs_per_cell; ++i)
+    {
+      for (unsigned int j = 0; j <= i; ++j)
+      {
+        stiffness_matrix[i][j] += (nu * scalar_product(shape.grad_phi_u[i], shape.grad_phi_u[j]) +
+                                   grad_div * shape.div_phi_u[i] * shape.div_phi_u[j]) * JxW;
+        mass_matrix[i][j] += shape.phi_u[i] * shape.phi_u[j] / deltat * JxW;
+        pressure_mass_matrix[i][j] += shape.phi_p[i] * shape.phi_p[j] / nu * JxW;
+      }
+
+      // Pressure terms in the momentum and continuity equations.
+      for (unsigned int j = 0; j < dofs_per_cell; ++j)
+        matrix[i][j] += (shape.phi_p[i] * shape.div_phi_u[j] -
+                         shape.phi_p[j] * shape.div_phi_u[i]) * JxW;
+    }
+  }
+
+  // Assemble all the local matrices and the right-hand side on one cell.
+  static void
+  assemble_cell(const FEValues<dim> &fe_values,
+                const std::vector<Tensor<1, dim>> &velocity_values,
+                const std::vector<double> &velocity_divergence,
+                const std::vector<Tensor<1, dim>> &forcing_values,
+                const double &nu,
+                const double &deltat,
+                const double &grad_div,
+                FullMatrix<double> &cell_matrix,
+                FullMatrix<double> &cell_mass_matrix,
+                FullMatrix<double> &cell_stiffness_matrix,
+                FullMatrix<double> &cell_convection_matrix,
+                FullMatrix<double> &cell_pressure_mass_matrix,
+                Vector<double> &cell_rhs)
+  {
+    AssertDimension(fe_values.dofs_per_cell, dofs_per_cell);
+
+    LocalMatrix<double> matrix{};
+    LocalMatrix<double> mass_matrix{};
+    LocalMatrix<double> stiffness_matrix{};
+    LocalMatrix<double> convection_matrix{};
+    LocalMatrix<double> pressure_mass_matrix{};
+    LocalVector<double> rhs{};
+    ShapeValues<double> shape;
+
+    for (unsigned int q = 0; q < fe_values.n_quadrature_points; ++q)
+    {
+      fill_shape_values(fe_values, q, shape);
+
+      static_kernel(shape, nu, deltat, grad_div, fe_values.JxW(q),
+                    matrix, mass_matrix, stiffness_matrix, pressure_mass_matrix);
+      convection_kernel<double>(shape.phi_u.data(), shape.grad_phi_u.data(), velocity_values[q],
+                                velocity_divergence[q], forcing_values[q],
+                                fe_values.JxW(q), deltat, convection_matrix, rhs);
+    }
+
+    for (unsigned int i = 0; i < dofs_per_cell; ++i)
+    {
+      for (unsigned int j = 0; j < dofs_per_cell; ++j)
+      {
+        const unsigned int row = std::max(i, j);
+        const unsigned int col = std::min(i, j);
+        cell_matrix(i, j) = matrix[i][j];
+        cell_mass_matrix(i, j) = mass_matrix[row][col];
+        cell_stiffness_matrix(i, j) = stiffness_matrix[row][col];
+        cell_convection_matrix(i, j) = convection_matrix[i][j];
+        cell_pressure_mass_matrix(i, j) = pressure_mass_matrix[row][col];
+      }
+      cell_rhs(i) = rhs[i];
+    }
+  }
+
+  // Assemble the convection matrix and the right-hand side on one cell.
+  static void
+  assemble_cell_convection(const FEValues<dim> &fe_values,
+                           const std::vector<Tensor<1, dim>> &velocity_values,
+                           const std::vector<double> &velocity_divergence,
+                           const std::vector<Tensor<1, dim>> &forcing_values,
+                           const double &deltat,
+                           FullMatrix<double> &cell_convection_matrix,
+                           Vector<double> &cell_rhs)
+  {
+    AssertDimension(fe_values.dofs_per_cell, dofs_per_cell);
+
+    LocalMatrix<double> convection_matrix{};
+    LocalVector<double> rhs{};
+    ShapeValues<double> shape;
+
+    for (unsigned int q = 0; q < fe_values.n_quadrature_points; ++q)
+    {
+      fill_shape_values(fe_values, q, shape);
+      convection_kernel<double>(shape.phi_u.data(), shape.grad_phi_u.data(), velocity_values[q],
+                                velocity_divergence[q], forcing_values[q],
+                                fe_values.JxW(q), deltat, convection_matrix, rhs);
+    }
+
+    for (unsigned int i = 0; i < dofs_per_cell; ++i)
+    {
+      for (unsigned int j = 0; j < dofs_per_cell; ++j)
+        cell_convection_matrix(i, j) = convection_matrix[i][j];
+      cell_rhs(i) = rhs[i];
+    }
+  }
+
+  // Add the convection matrix and the right-hand side of the first n_filled
+  // lanes of a batch to the corresponding local matrices and vectors.
+  static void
+  assemble_batch_convection(const CellBatch<dim> &batch,
+                            const unsigned int &n_filled,
+                            const double &deltat,
+                            std::vector<FullMatrix<double>> &cell_convection_matrices,
+                            std::vector<Vector<double>> &cell_rhs)
+  {
+    using Number = typename CellBatch<dim>::Number;
+
+    AssertDimension(batch.dofs_per_cell, dofs_per_cell);
+
+    LocalMatrix<Number> convection_matrix;
+    LocalVector<Number> rhs;
+    for (unsigned int i = 0; i < dofs_per_cell; ++i)
+    {
+      for (unsigned int j = 0; j < dofs_per_cell; ++j)
+        convection_matrix[i][j] = 0.0;
+      rhs[i] = 0.0;
+    }
+
+    for (unsigned int q = 0; q < batch.n_q; ++q)
+      convection_kernel<Number>(&batch.phi_u[q * dofs_per_cell],
+                                &batch.grad_phi_u[q * dofs_per_cell],
+                                batch.velocity[q],
+                                batch.velocity_divergence[q],
+                                batch.forcing[q],
+                                batch.JxW[q],
+                                deltat,
+                                convection_matrix,
+                                rhs);
+
+    for (unsigned int lane = 0; lane < n_filled; ++lane)
+    {
+      for (unsigned int i = 0; i < dofs_per_cell; ++i)
+      {
+        for (unsigned int j = 0; j < dofs_per_cell; ++j)
+          cell_convection_matrices[lane](i, j) += convection_matrix[i][j][lane];
+        cell_rhs[lane](i) += rhs[i][lane];
+      }
+    }
+  }
+};
+
+// Generic local assembly, for any pair of degrees.
+template <int dim>
+class GenericAssemblyKernel
+{
+public:
+  static void
+  assemble_cell(const FEValues<dim> &fe_values,
+                const std::vector<Tensor<1, dim>> &velocity_values,
+                const std::vector<double> &velocity_divergence,
+                const std::vector<Tensor<1, dim>> &forcing_values,
+                const double &nu,
+                const double &deltat,
+                const double &grad_div,
+                FullMatrix<double> &cell_matrix,
+                FullMatrix<double> &cell_mass_matrix,
+                FullMatrix<double> &cell_stiffness_matrix,
+                FullMatrix<double> &cell_convection_matrix,
+                FullMatrix<double> &cell_pressure_mass_matrix,
+                Vector<double> &cell_rhs)
+  {
+    const unsigned int dofs_per_cell = fe_values.dofs_per_cell;
+
+    const FEValuesExtractors::Vector velocity(0);
+    const FEValuesExtractors::Scalar pressure(dim);
+
+    cell_matrix = 0.0;
+    cell_mass_matrix = 0.0;
+    cell_stiffness_matrix = 0.0;
+    cell_pressure_mass_matrix = 0.0;
+
+    // Divergence of the velocity shape functions at the quadrature point.
+    std::vector<double> div_phi_u(dofs_per_cell);
+
+    for (unsigned int q = 0; q < fe_values.n_quadrature_points; ++q)
+    {
+      for (unsigned int k = 0; k < dofs_per_cell; ++k)
+        div_phi_u[k] = fe_values[velocity].divergence(k, q);
+
+      for (unsigned int i = 0; i < dofs_per_cell; ++i)
+      {
+        for (unsigned int j = 0; j < dofs_per_cell; ++j)
+        {
+          // Viscosity term.
+          cell_stiffness_matrix(i, j) += nu * scalar_product(fe_values[velocity].gradient(i, q), fe_values[velocity].gradient(j, q)) * fe_values.JxW(q);
+
+          // Grad-div term.
+          cell_stiffness_matrix(i, j) += grad_div * div_phi_u[i] * div_phi_u[j] * fe_values.JxW(q);
+
+          // Time derivative discretization.
+          cell_mass_matrix(i, j) +=  scalar_product(fe_values[velocity].value(i, q), fe_values[velocity].value(j, q)) / deltat * fe_values.JxW(q);
+
+          // Pressure term in the momentum equation.
+          cell_matrix(i, j) -= fe_values[pressure].value(j, q) * div_phi_u[i] * fe_values.JxW(q);
+
+          // Pressure term in the continuity equation.
+          cell_matrix(i, j) += fe_values[pressure].value(i, q) * div_phi_u[j] * fe_values.JxW(q);
+
+          // Pressure mass matrix.
+          cell_pressure_mass_matrix(i, j) += fe_values[pressure].value(i, q) * fe_values[pressure].value(j, q) / nu * fe_values.JxW(q);
+        }
+      }
+    }
+
+    assemble_cell_convection(fe_values, velocity_values, velocity_divergence,
+                             forcing_values, deltat, cell_convection_matrix, cell_rhs);
+  }
+
+  static void
+  assemble_cell_convection(const FEValues<dim> &fe_values,
+                           const std::vector<Tensor<1, dim>> &velocity_values,
+                           const std::vector<double> &velocity_divergence,
+                           const std::vector<Tensor<1, dim>> &forcing_values,
+                           const double &deltat,
+                           FullMatrix<double> &cell_convection_matrix,
+                           Vector<double> &cell_rhs)
+  {
+    const unsigned int dofs_per_cell = fe_values.dofs_per_cell;
+
+    const FEValuesExtractors::Vector velocity(0);
+
+    cell_convection_matrix = 0.0;
+    cell_rhs = 0.0;
+
+    for (unsigned int q = 0; q < fe_values.n_quadrature_points; ++q)
+    {
+      for (unsigned int i = 0; i < dofs_per_cell; ++i)
+      {
+        for (unsigned int j = 0; j < dofs_per_cell; ++j)
+        {
+          // Convective term
+          cell_convection_matrix(i, j) += scalar_product(fe_values[velocity].gradient(j, q) * velocity_values[q], fe_values[velocity].value(i, q)) * fe_values.JxW(q);
+
+          // Temam Stabilization term
+          cell_convection_matrix(i, j) += 0.5 * velocity_divergence[q] * scalar_product(fe_values[velocity].value(i, q), fe_values[velocity].value(j, q)) * fe_values.JxW(q);
+        }
+
+        // Time derivative discretization on the right hand side
+        cell_rhs(i) +=  scalar_product(velocity_values[q], fe_values[velocity].value(i, q)) * fe_values.JxW(q) / deltat;
+
+        // Forcing term.
+        cell_rhs(i) += scalar_product(forcing_values[q], fe_values[velocity].value(i, q)) * fe_values.JxW(q);
+      }
+    }
+  }
+};
+
+// PSPG (and optionally SUPG) stabilization of the equal order P1/P1 (Q1/Q1)
+// elements, which do not satisfy the inf-sup condition. The momentum residual
+//
+//   R(u, p) = u/dt + (w . grad) u - nu lap(u) + grad p - f - u^n/dt
+//
+// is tested against tau grad q (PSPG) and tau (w . grad) v (SUPG), w being the
+// convective velocity. With linear elements lap(u) vanishes in each cell. The
+// parameter tau depends on w, so all the terms (also the pressure Laplacian
+// tau (grad p, grad q) of the pressure-pressure block) are added to the
+// convection matrix, which is assembled at each step.
+template <int dim>
+class StabilizationKernel
+{
+public:
+  // Stabilization parameter at a point with velocity w, on a cell of diameter
+  // h (Tezduyar-Shakib). The time step term is dropped in the steady problem.
+  static double
+  tau(const Tensor<1, dim> &w, const double &h, const double &nu,
+      const double &deltat, const bool &time_derivative)
+  {
+    const double time_term = time_derivative ? 2. / deltat : 0.;
+    const double convection_term = 2. * w.norm() / h;
+    const double diffusion_term = 4. * nu / (h * h);
+    return 1. / std::sqrt(time_term * time_term + convection_term * convection_term +
+                          9. * diffusion_term * diffusion_term);
+  }
+
+  // Add the stabilization terms of one cell, linearized around the
+  // convective velocity (Picard), to the convection matrix and the
+  // right-hand side.
+  static void
+  add_cell_terms(const FEValues<dim> &fe_values,
+                 const std::vector<Tensor<1, dim>> &convective_velocity,
+                 const std::vector<Tensor<1, dim>> &old_velocity,
+                 const std::vector<Tensor<1, dim>> &forcing_values,
+                 const double &h,
+                 const double &nu,
+                 const double &deltat,
+                 const bool &time_derivative,
+                 const bool &supg,
+                 FullMatrix<double> &cell_convection_matrix,
+                 Vector<double> &cell_rhs)
+  {
+    const unsigned int dofs_per_cell = fe_values.dofs_per_cell;
+
+    const FEValuesExtractors::Vector velocity(0);
+    const FEValuesExtractors::Scalar pressure(dim);
+
+    // Test and trial operators of each shape function.
+    std::vector<Tensor<1, dim>> test(dofs_per_cell);
+    std::vector<Tensor<1, dim>> trial(dofs_per_cell);
+
+    for (unsigned int q = 0; q < fe_values.n_quadrature_points; ++q)
+    {
+      const Tensor<1, dim> &w = convective_velocity[q];
+      const double tau_JxW = tau(w, h, nu, deltat, time_derivative) * fe_values.JxW(q);
+
+      Tensor<1, dim> rhs_integrand = forcing_values[q];
+      if (time_derivative)
+        rhs_integrand += old_velocity[q] / deltat;
+
+      for (unsigned int k = 0; k < dofs_per_cell; ++k)
+      {
+        const Tensor<2, dim> grad_phi_u = fe_values[velocity].gradient(k, q);
+        const Tensor<1, dim> grad_phi_p = fe_values[pressure].gradient(k, q);
+
+        trial[k] = grad_phi_u * w + grad_phi_p;
+        if (time_derivative)
+          trial[k] += fe_values[velocity].value(k, q) / deltat;
+
+        test[k] = grad_phi_p;
+        if (supg)
+          test[k] += grad_phi_u * w;
+      }
+
+      for (unsigned int i = 0; i < dofs_per_cell; ++i)
+      {
+        for (unsigned int j = 0; j < dofs_per_cell; ++j)
+          cell_convection_matrix(i, j) += test[i] * trial[j] * tau_JxW;
+
+        cell_rhs(i) += test[i] * rhs_integrand * tau_JxW;
+      }
+    }
+  }
+};
+
+// Local assembler used by the solver: it dispatches each cell to the kernel
+// specialized for the degrees of the problem (Taylor-Hood P2/P1 and equal
+// order P1/P1), or to the generic kernel for any other pair and for the
+// hexahedral (Q_k) elements.
+template <int dim>
+class CellAssembler
+{
+public:
+  CellAssembler(const unsigned int &degree_velocity, const unsigned int &degree_pressure,
+                const bool &simplex = true)
+  {
+    if (!simplex)
+      kernel = Kernel::generic;
+    else if (degree_velocity == 2 && degree_pressure == 1)
+      kernel = Kernel::P2P1;
+    else if (degree_velocity == 1 && degree_pressure == 1)
+      kernel = Kernel::P1P1;
+    else
+      kernel = Kernel::generic;
+  }
+
+  // True if a compile time specialized kernel is used.
+  bool
+  is_specialized() const
+  {
+    return kernel != Kernel::generic;
+  }
+
+  // Assemble all the local matrices and the right-hand side on one cell.
+  template <typename... Args>
+  void
+  assemble_cell(Args &&...args) const
+  {
+    switch (kernel)
+    {
+      case Kernel::P2P1:
+        AssemblyKernel<dim, 2, 1>::assemble_cell(std::forward<Args>(args)...);
+        break;
+      case Kernel::P1P1:
+        AssemblyKernel<dim, 1, 1>::assemble_cell(std::forward<Args>(args)...);
+        break;
+      default:
+        GenericAssemblyKernel<dim>::assemble_cell(std::forward<Args>(args)...);
+    }
+  }
+
+  // Number of cells assembled together by assemble_batch_convection (one
+  // if the cells have to be assembled one at a time).
+  unsigned int
+  n_batch_lanes() const
+  {
+    return is_specialized() ? CellBatch<dim>::n_lanes : 1;
+  }
+
+  // Add the convection matrix and the right-hand side of the first n_filled
+  // lanes of a batch. Only available with a specialized kernel.
+  template <typename... Args>
+  void
+  assemble_batch_convection(Args &&...args) const
+  {
+    switch (kernel)
+    {
+      case Kernel::P2P1:
+        AssemblyKernel<dim, 2, 1>::assemble_batch_convection(std::forward<Args>(args)...);
+        break;
+      case Kernel::P1P1:
+        AssemblyKernel<dim, 1, 1>::assemble_batch_convection(std::forward<Args>(args)...);
+        break;
+      default:
+        AssertThrow(false, ExcMessage("Batched assembly needs a specialized kernel."));
+    }
+  }
+
+  // Assemble the convection matrix and the right-hand side on one cell.
+  template <typename... Args>
+  void
+  assemble_cell_convection(Args &&...args) const
+  {
+    switch (kernel)
+    {
+      case Kernel::P2P1:
+        AssemblyKernel<dim, 2, 1>::assemble_cell_convection(std::forward<Args>(args)...);
+        break;
+      case Kernel::P1P1:
+        AssemblyKernel<dim, 1, 1>::assemble_cell_convection(std::forward<Args>(args)...);
+        break;
+      default:
+        GenericAssemblyKernel<dim>::assemble_cell_convection(std::forward<Args>(args)...);
+    }
+  }
+
+protected:
+  enum class Kernel
+  {
+    P2P1,
+    P1P1,
+    generic
+  };
+
+  Kernel kernel;
+};
+
+#endif
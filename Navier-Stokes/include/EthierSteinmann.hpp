@@ -1,14 +1,14 @@
-#ifndef NAVIER_STOKES_HPP
-#define NAVIER_STOKES_HPP
-
-#include "Preconditioners.hpp"
-#include "IncludesFile.hpp"
+#ifndef ETHIER_STEINMANN_HPP
+#define ETHIER_STEINMANN_HPP
 
+#include "ProblemDescription.hpp"
 
 using namespace dealii;
 
-// Class implementing a solver for the NS problem.
-class NavierStokes
+// Ethier-Steinmann exact solution on the cube, used for the convergence study.
+// Boundary ids of the meshes: 3 is the face y = -1 (Neumann), the other faces
+// are Dirichlet.
+class EthierSteinmann : public ProblemDescription<3>
 {
 public:
   // Physical dimension (3D)
@@ -18,7 +18,7 @@ public:
   class ForcingTerm : public Function<dim>
   {
   public:
-    ForcingTerm()
+    ForcingTerm() : Function<dim>(dim)
     {
     }
 
@@ -123,10 +123,6 @@ public:
       values[2][0] = -a * std::exp( -nu * b * b * get_time() ) * ( a * std::exp(a * p[2]) * std::cos(a * p[0] + b * p[1]) - b * std::exp(a * p[1]) * std::sin(a * p[2] + b * p[0]) );
       values[2][1] = -a * std::exp( -nu * b * b * get_time() ) * ( b * std::exp(a * p[2]) * std::cos(a * p[0] + b * p[1]) + a * std::exp(a * p[1]) * std::cos(a * p[2] + b * p[0]) );
       values[2][2] = -a * std::exp( -nu * b * b * get_time() ) * ( a * std::exp(a * p[2]) * std::sin(a * p[0] + b * p[1]) - a * std::exp(a * p[1]) * std::sin(a * p[2] + b * p[0]) );
-        
-      values[3][0] = 0.0;
-      values[3][1] = 0.0;
-      values[3][2] = 0.0;    
 
       return values;
       }
@@ -135,9 +131,14 @@ public:
      gradient(const Point<dim> &p, const unsigned int component = 0) const override
       {
       
-      Tensor<2, dim> grad_tensor = gradient_tensor(p);
       Tensor<1, dim> grad_component;
 
+      // The pressure gradient is not needed for the velocity errors.
+      if (component == dim)
+        return grad_component;
+
+      Tensor<2, dim> grad_tensor = gradient_tensor(p);
+
       for (unsigned int i = 0; i < dim; ++i)
         grad_component[i] = grad_tensor[component][i];
 
@@ -200,224 +201,114 @@ public:
 
     };
 
-  
-
-  // Function for the initial condition.
-  class FunctionU0 : public Function<dim>
+  // The label is appended to the name and to the output directory, to tell
+  // apart the meshes solved concurrently.
+  EthierSteinmann(const std::string &label_ = "")
+    : label(label_)
   {
-  public:
-    FunctionU0()
-    {
-    }
-
-    virtual double
-    value(const Point<dim> & p, const unsigned int component) const override
-    {
-    double factor = -(a * a * std::exp(-2 * nu * b * b * 0.0)) / 2.0;
-    double term1 = 2 * std::sin(a * p[0] + b * p[1]) * std::cos(a * p[2] + b * p[0]) * std::exp(a * (p[1] + p[2]));
-    double term2 = 2 * std::sin(a * p[1] + b * p[2]) * std::cos(a * p[0] + b * p[1]) * std::exp(a * (p[0] + p[2]));
-    double term3 = 2 * std::sin(a * p[2] + b * p[0]) * std::cos(a * p[1] + b * p[2]) * std::exp(a * (p[0] + p[1]));
-    double term4 = std::exp(2 * a * p[0]) + std::exp(2 * a * p[1]) + std::exp(2 * a * p[2]);
-    double pressure = factor * (term1 + term2 + term3 + term4);
-
-        if (component == 0)
-        {
-            return -a * std::exp(-nu * b * b * 0.0) * 
-                  (std::exp(a * p[0]) * std::sin(a * p[1] + b * p[2]) + 
-                    std::exp(a * p[2]) * std::cos(a * p[0] + b * p[1]));
-        }
-        else if (component == 1)
-        {
-            return -a * std::exp(-nu * b * b * 0.0) * 
-                  (std::exp(a * p[1]) * std::sin(a * p[2] + b * p[0]) + 
-                    std::exp(a * p[0]) * std::cos(a * p[1] + b * p[2]));
-        }
-        else if (component == 2)
-        {
-            return -a * std::exp(-nu * b * b * 0.0) * 
-                  (std::exp(a * p[2]) * std::sin(a * p[0] + b * p[1]) + 
-                    std::exp(a * p[1]) * std::cos(a * p[2] + b * p[0]));
-        }
-        else
-        {
-            return pressure;
-        }
-      }
-    virtual void
-    vector_value(const Point<dim> & p, Vector<double> &values) const override
-    {
-    double factor = -(a * a * std::exp(-2 * nu * b * b * 0.0)) / 2.0;
-    double term1 = 2.0 * std::sin(a * p[0] + b * p[1]) * std::cos(a * p[2] + b * p[0]) * std::exp(a * (p[1] + p[2]));
-    double term2 = 2.0 * std::sin(a * p[1] + b * p[2]) * std::cos(a * p[0] + b * p[1]) * std::exp(a * (p[0] + p[2]));
-    double term3 = 2.0 * std::sin(a * p[2] + b * p[0]) * std::cos(a * p[1] + b * p[2]) * std::exp(a * (p[0] + p[1]));
-    double term4 = std::exp(2 * a * p[0]) + std::exp(2 * a * p[1]) + std::exp(2 * a * p[2]);
-    double pressure = (factor * (term1 + term2 + term3 + term4));
-
-      values[0] = -a * std::exp( -nu * b * b * 0.0 ) * ( std::exp(a * p[0]) * std::sin(a * p[1] + b * p[2]) + std::exp(a * p[2]) * std::cos(a * p[0] + b * p[1]) );
-      values[1] = -a * std::exp( -nu * b * b * 0.0 ) * ( std::exp(a * p[1]) * std::sin(a * p[2] + b * p[0]) + std::exp(a * p[0]) * std::cos(a * p[1] + b * p[2]) );
-      values[2] = -a * std::exp( -nu * b * b * 0.0 ) * ( std::exp(a * p[2]) * std::sin(a * p[0] + b * p[1]) + std::exp(a * p[1]) * std::cos(a * p[2] + b * p[0]) );
-      values[3] = pressure;
-    }
-    private:
-    const double nu = 1e-2;
-    const double a = M_PI / 4.0;
-    const double b = M_PI / 2.0; 
-  };
+  }
 
-  
-  // Constructor.
-  NavierStokes(const std::string &mesh_file_name_,
-               const unsigned int &degree_velocity_,
-               const unsigned int &degree_pressure_,
-               const double &T_,
-               const double &deltat_)
-      : mpi_size(Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD)), mpi_rank(Utilities::MPI::this_mpi_process(MPI_COMM_WORLD)), pcout(std::cout, mpi_rank == 0), T(T_), mesh_file_name(mesh_file_name_), degree_velocity(degree_velocity_), degree_pressure(degree_pressure_), deltat(deltat_), mesh(MPI_COMM_WORLD)
+  virtual std::string
+  name() const override
   {
+    return "Convergence" + label;
   }
 
-  // Setup system.
-  void
-  setup();
-
-  // Solve system.
-  void
-  solve();
-
-  // Compute the error.
-  double
-  compute_error(const VectorTools::NormType &norm_type);
+  virtual double
+  viscosity() const override
+  {
+    return nu;
+  }
 
+  virtual void
+  set_time(const double &time) override
+  {
+    forcing.set_time(time);
+    function_h.set_time(time);
+    exact.set_time(time);
+  }
 
-  std::vector<double> time_prec;
-  std::vector<double> time_solve;
+  virtual std::vector<BoundaryFunctions>
+  dirichlet_boundaries() const override
+  {
+    BoundaryFunctions boundary_functions;
+    for (const types::boundary_id id : {0, 1, 2, 4, 5})
+      boundary_functions[id] = &exact;
 
-protected:
-  // Assemble system. We also assemble the pressure mass matrix (needed for the
-  // preconditioner).
-  void
-  assemble(const double &time);
+    return {boundary_functions};
+  }
 
-  void
-  assemble_time_step(const double &time);
+  // The velocity is the one at t = 0 times exp(-nu b^2 t).
+  virtual std::vector<BoundaryFunctions>
+  dirichlet_profiles() const override
+  {
+    BoundaryFunctions boundary_functions;
+    for (const types::boundary_id id : {0, 1, 2, 4, 5})
+      boundary_functions[id] = &exact_initial;
 
-  // Solve the problem for one time step.
-  void
-  solve_time_step();
+    return {boundary_functions};
+  }
 
-  // Output results.
-  void
-  output(const unsigned int &time_step) const;
+  virtual double
+  dirichlet_time_factor() const override
+  {
+    const double b = M_PI / 2.0;
+    return std::exp(-nu * b * b * exact.get_time());
+  }
 
+  virtual std::set<types::boundary_id>
+  neumann_boundary_ids() const override
+  {
+    return {3};
+  }
 
-  // MPI parallel. /////////////////////////////////////////////////////////////
+  virtual const Function<dim> &
+  neumann_function() const override
+  {
+    return function_h;
+  }
 
-  // Number of MPI processes.
-  const unsigned int mpi_size;
+  virtual const Function<dim> &
+  forcing_term() const override
+  {
+    return forcing;
+  }
 
-  // This MPI process.
-  const unsigned int mpi_rank;
+  // The initial condition is the exact solution at t = 0.
+  virtual const Function<dim> &
+  initial_condition() const override
+  {
+    return exact;
+  }
 
-  // Parallel output stream.
-  ConditionalOStream pcout;
+  virtual const Function<dim> *
+  exact_solution() const override
+  {
+    return &exact;
+  }
 
-  // Problem definition. ///////////////////////////////////////////////////////
+  virtual std::string
+  output_directory() const override
+  {
+    return "./outputConvergence" + label + "/";
+  }
 
+protected:
   // Kinematic viscosity [m2/s].
   const double nu = 1e-2;
 
-  // Density
-  const double rho = 1.;
+  // Suffix of the name.
+  const std::string label;
 
   // Forcing term.
-  ForcingTerm forcing_term;
-
-
-
-  // Final time.
-  const double T;
-
-  double drag;
-  double lift;
-
-  // Discretization. ///////////////////////////////////////////////////////////
-
-  // Mesh file name.
-  const std::string mesh_file_name;
-
-  // Polynomial degree used for velocity.
-  const unsigned int degree_velocity;
-
-  // Polynomial degree used for pressure.
-  const unsigned int degree_pressure;
-
-  // TIme step.
-  const double deltat;
-
-  ExactSolution exact_solution;
-
-
+  ForcingTerm forcing;
 
   // h(x).
   FunctionH function_h;
 
-  // Initial condition.
-  FunctionU0 u_0;
-
-  // Mesh.
-  parallel::fullydistributed::Triangulation<dim> mesh;
-
-  // Finite element space.
-  std::unique_ptr<FiniteElement<dim>> fe;
-
-  // Quadrature formula.
-  std::unique_ptr<Quadrature<dim>> quadrature;
-
-  // Quadrature formula used on boundary lines.
-  std::unique_ptr<Quadrature<dim - 1>> quadrature_boundary;
-
-  // DoF handler.
-  DoFHandler<dim> dof_handler;
-
-  // DoFs owned by current process.
-  IndexSet locally_owned_dofs;
-
-  // DoFs owned by current process in the velocity and pressure blocks.
-  std::vector<IndexSet> block_owned_dofs;
-
-  // DoFs relevant to the current process (including ghost DoFs).
-  IndexSet locally_relevant_dofs;
-
-  // DoFs relevant to current process in the velocity and pressure blocks.
-  std::vector<IndexSet> block_relevant_dofs;
-
-  std::vector<Tensor<1, dim>> previous_velocity_values;
-
-   std::vector<Tensor<2, dim>> previous_gradient_velocity_values;
-
-  // System matrix.
-  TrilinosWrappers::BlockSparseMatrix system_matrix;
-  // A
-  TrilinosWrappers::BlockSparseMatrix stiffness_matrix;
-  // M
-  TrilinosWrappers::BlockSparseMatrix mass_matrix;
-  // C(u_k)
-  TrilinosWrappers::BlockSparseMatrix convection_matrix;
-
-  // Pressure mass matrix, needed for preconditioning. We use a block matrix for
-  // convenience, but in practice we only look at the pressure-pressure block.
-  TrilinosWrappers::BlockSparseMatrix pressure_mass;
-
-  // Right-hand side vector in the linear system.
-  TrilinosWrappers::MPI::BlockVector system_rhs;
-
-  // System solution (without ghost elements).
-  TrilinosWrappers::MPI::BlockVector solution_owned;
-
-  // System solution (including ghost elements).
-  TrilinosWrappers::MPI::BlockVector solution;
-
-
-  TrilinosWrappers::MPI::BlockVector previous_solution;
+  // Exact solution, and the exact solution at t = 0 (never moved in time).
+  ExactSolution exact;
+  ExactSolution exact_initial;
 };
 
 #endif
@@ -0,0 +1,294 @@
+#ifndef FLOW_PAST_CYLINDER_HPP
+#define FLOW_PAST_CYLINDER_HPP
+
+#include "ProblemDescription.hpp"
+
+using namespace dealii;
+
+// Benchmark "flow past a cylinder" in 2D and 3D (Schafer-Turek). Boundary ids
+// of the meshes: 0 inlet, 1 outlet, 2 walls, 3 cylinder.
+template <int dim>
+class FlowPastCylinder : public ProblemDescription<dim>
+{
+public:
+  // Function for inlet velocity based on 3 tests
+  class InletVelocity : public Function<dim>
+  {
+  public:
+    // Without the time factor, the function is the spatial profile of the
+    // inlet datum.
+    InletVelocity(const unsigned int &test_case_, const double &u_m_,
+                  const bool &with_time_factor_ = true)
+      : Function<dim>(dim + 1), test_case(test_case_), u_m(u_m_)
+      , with_time_factor(with_time_factor_)
+    {
+    }
+
+    virtual void
+    vector_value(const Point<dim> &p, Vector<double> &values) const override
+    {
+      for (unsigned int i = 0; i < dim + 1; ++i)
+        values[i] = value(p, i);
+    }
+
+    virtual double
+    value(const Point<dim> &p, const unsigned int component = 0) const override
+    {
+      if (component == 0)
+        return u_m * profile(p) * (with_time_factor ? time_factor() : 1.0);
+      else
+        return 0;
+    }
+
+    // Parabolic profile, equal to 1 at the center of the inlet.
+    double
+    profile(const Point<dim> &p) const
+    {
+      if constexpr (dim == 2)
+        return 4.0 * p[1] * (H - p[1]) / (H * H);
+      else
+        return 16.0 * p[1] * p[2] * (H - p[2]) * (H - p[1]) / (H * H * H * H);
+    }
+
+    // Time modulation of the inlet velocity. Test cases are numbered as in
+    // the original 2D and 3D drivers, except 2D case 1 which is the steady
+    // benchmark instead of a zero inflow (3D case 1 is still a zero inflow).
+    double
+    time_factor() const
+    {
+      if constexpr (dim == 2)
+      {
+        switch (test_case)
+        {
+          case 1:
+            return 1.0;
+          case 2:
+            return std::sin(M_PI * this->get_time() / 8.0);
+          case 3:
+          default:
+            return 1.0;
+        }
+      }
+      else
+      {
+        switch (test_case)
+        {
+          case 1:
+            return 0.0;
+          case 3:
+            return std::sin(M_PI * this->get_time() / 8.0);
+          case 2:
+          default:
+            return 1.0;
+        }
+      }
+    }
+
+    // Maximum velocity of the profile, without the time factor.
+    double
+    max_velocity() const
+    {
+      return u_m;
+    }
+
+    // Mean velocity over the inlet: 2U/3 in 2D and 4U/9 in 3D.
+    double
+    getMeanVelocity() const
+    {
+      const double profile_mean = (dim == 2) ? 2.0 / 3.0 : 4.0 / 9.0;
+      return profile_mean * u_m * time_factor();
+    }
+
+  protected:
+    const unsigned int test_case;
+    const double H = 0.41;
+    const double u_m;
+    const bool with_time_factor;
+  };
+
+  // In 2D, test case 1 is the steady benchmark (U = 0.3, Re = 20).
+  FlowPastCylinder(const unsigned int &test_case_ = 2)
+    : FlowPastCylinder(test_case_, default_max_velocity(test_case_), 1e-3)
+  {
+  }
+
+  // Test case with the given maximum inlet velocity and viscosity, for
+  // parameter sweeps. The label is appended to the name of the problem.
+  FlowPastCylinder(const unsigned int &test_case_,
+                   const double &u_m_,
+                   const double &nu_,
+                   const std::string &label_ = "")
+    : test_case(test_case_)
+    , nu(nu_)
+    , label(label_)
+    , inlet_velocity(test_case, u_m_)
+    , inlet_profile(test_case, u_m_, false)
+  {
+  }
+
+  // Maximum inlet velocity of the benchmark test cases.
+  static double
+  default_max_velocity(const unsigned int &test_case)
+  {
+    return (dim == 2) ? (test_case == 1 ? 0.3 : 1.5) : 9.0;
+  }
+
+  virtual std::string
+  name() const override
+  {
+    return std::to_string(dim) + "D" + label;
+  }
+
+  virtual std::string
+  configuration() const override
+  {
+    return name() + "_test" + std::to_string(test_case) + "_um" +
+           std::to_string(inlet_velocity.max_velocity()) + "_nu" + std::to_string(nu);
+  }
+
+  virtual double
+  viscosity() const override
+  {
+    return nu;
+  }
+
+  virtual void
+  set_time(const double &time) override
+  {
+    inlet_velocity.set_time(time);
+  }
+
+  // The inlet is imposed first, walls and obstacle then override it on the
+  // DoFs they share with the inlet.
+  virtual std::vector<typename ProblemDescription<dim>::BoundaryFunctions>
+  dirichlet_boundaries() const override
+  {
+    typename ProblemDescription<dim>::BoundaryFunctions inlet;
+    inlet[0] = &inlet_velocity;
+
+    typename ProblemDescription<dim>::BoundaryFunctions walls;
+    walls[2] = &this->zero_function;
+    walls[3] = &this->zero_function;
+
+    return {inlet, walls};
+  }
+
+  // Only the inlet depends on time, through the factor of the test case.
+  virtual std::vector<typename ProblemDescription<dim>::BoundaryFunctions>
+  dirichlet_profiles() const override
+  {
+    typename ProblemDescription<dim>::BoundaryFunctions inlet;
+    inlet[0] = &inlet_profile;
+
+    typename ProblemDescription<dim>::BoundaryFunctions walls;
+    walls[2] = &this->zero_function;
+    walls[3] = &this->zero_function;
+
+    return {inlet, walls};
+  }
+
+  virtual double
+  dirichlet_time_factor() const override
+  {
+    return inlet_velocity.time_factor();
+  }
+
+  // The channel with cylinder of deal.II has the geometry of the 2D benchmark.
+  // In 3D it is the 2D channel extruded (2.2 long, cylinder at x = 0.2): the
+  // part upstream of the cylinder, x < 0.1, is stretched to x < 0.4 and the
+  // rest is shifted by 0.3, which gives the 3D benchmark (2.5 long, cylinder
+  // at x = 0.5) with the cylinder and its shells unchanged. The manifolds
+  // are then attached again around the moved cylinder. The boundary ids are
+  // 0 inlet, 1 outlet, 2 cylinder and 3 walls: cylinder and walls are
+  // swapped to match the meshes.
+  virtual void
+  make_hex_mesh(Triangulation<dim> &mesh) const override
+  {
+    GridGenerator::channel_with_cylinder(mesh, 0.03, 2, 2.0, true);
+    for (const auto &cell : mesh.cell_iterators_on_level(0))
+      for (const auto &face : cell->face_iterators())
+        if (face->at_boundary() && (face->boundary_id() == 2 || face->boundary_id() == 3))
+          face->set_boundary_id(5 - face->boundary_id());
+
+    if constexpr (dim == 3)
+    {
+      GridTools::transform(
+          [](const Point<dim> &p) {
+            Point<dim> q = p;
+            q[0] = (p[0] <= 0.1 + 1e-12) ? 4.0 * p[0] : p[0] + 0.3;
+            return q;
+          },
+          mesh);
+
+      // Manifold ids of channel_with_cylinder: 0 cylinder, 1 transfinite
+      // interpolation of the cells around it.
+      Tensor<1, dim> axis;
+      axis[2] = 1.0;
+      mesh.set_manifold(0, CylindricalManifold<dim>(axis, Point<dim>(0.5, 0.2, 0.0)));
+      TransfiniteInterpolationManifold<dim> inner_manifold;
+      inner_manifold.initialize(mesh);
+      mesh.set_manifold(1, inner_manifold);
+    }
+  }
+
+  virtual types::boundary_id
+  obstacle_boundary_id() const override
+  {
+    return 3;
+  }
+
+  // Coefficients are 2F / (rho U^2 D) in 2D and 2F / (rho U^2 D H) in 3D.
+  virtual double
+  reference_force() const override
+  {
+    const double mean_v = inlet_velocity.getMeanVelocity();
+    const double area = (dim == 2) ? D : D * H;
+    return 0.5 * this->density() * mean_v * mean_v * area;
+  }
+
+  virtual double
+  forces_start_time() const override
+  {
+    return (dim == 2) ? 0.0 : 0.1;
+  }
+
+  virtual std::vector<Point<dim>>
+  pressure_probe_points() const override
+  {
+    if constexpr (dim == 2)
+      return {Point<dim>(0.15, 0.2), Point<dim>(0.25, 0.2)};
+    else
+      return {Point<dim>(0.45, 0.2, 0.205), Point<dim>(0.55, 0.2, 0.205)};
+  }
+
+  virtual double
+  reynolds_number() const override
+  {
+    return inlet_velocity.getMeanVelocity() * D / nu;
+  }
+
+  virtual unsigned int
+  output_interval() const override
+  {
+    return (dim == 2) ? 1 : 20;
+  }
+
+protected:
+  const unsigned int test_case;
+
+  // Kinematic viscosity [m2/s].
+  const double nu;
+
+  // Suffix of the name.
+  const std::string label;
+
+  // Diameter of the cylinder and height of the channel.
+  const double D = 0.1;
+  const double H = 0.41;
+
+  // Inlet velocity, and its spatial profile (without the time factor).
+  InletVelocity inlet_velocity;
+  InletVelocity inlet_profile;
+};
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef MATRIX_FREE_OPERATOR_HPP
+#define MATRIX_FREE_OPERATOR_HPP
+
+#include "IncludesFile.hpp"
+using namespace dealii;
+
+// Matrix-free application of the linearized (Oseen) system
+//
+//   [ M/dt + A + C(w)  B^T ] [u]
+//   [ B                0   ] [p]
+//
+// on hexahedral meshes with Q_k elements. The cell integrals are evaluated
+// with sum factorization (FEEvaluation) on the quadrature of the assembly,
+// so the operator is the one of the assembled system matrix, which is still
+// needed by the preconditioners: only the products of the outer solve are
+// done without the matrix. The convective velocity w and its divergence are
+// stored at the quadrature points. A includes the grad-div term, if any.
+// Constrained rows only have their diagonal entry, copied from the
+// assembled matrix.
+//
+// The evaluation uses one DoF handler per block, renumbered as the blocks
+// of the system DoF handler: with the component-wise numbering, the locally
+// owned DoFs of the monolithic handler are two ranges (velocity and
+// pressure), while the partitioners of MatrixFree need one, so each block
+// gets its own handler, partitioner and block of the matrix-free vectors,
+// with the same locally owned entries as the Trilinos blocks.
+template <int dim, int degree_velocity, int degree_pressure>
+class MatrixFreeOseenOperator
+{
+public:
+  using VectorType = LinearAlgebra::distributed::BlockVector<double>;
+  using Number = VectorizedArray<double>;
+
+  static constexpr int n_q_points_1d = degree_velocity + 1;
+
+  MatrixFreeOseenOperator()
+    : fe_velocity(FE_Q<dim>(degree_velocity), dim)
+    , fe_pressure(degree_pressure)
+  {
+  }
+
+  // Set up the evaluation on the mesh of the system DoF handler (velocity
+  // then pressure, component-wise), with the constrained DoFs of the
+  // assembly.
+  void
+  reinit(const DoFHandler<dim> &dof_handler,
+         const AffineConstraints<double> &constraints,
+         const double &nu_,
+         const double &deltat_,
+         const double &grad_div_ = 0.0)
+  {
+    nu = nu_;
+    deltat = deltat_;
+    grad_div = grad_div_;
+
+    setup_block_dof_handlers(dof_handler);
+    const types::global_dof_index n_u = dof_handler_velocity.n_dofs();
+
+    // Constraints of each block, on the numbering of the block.
+    IndexSet velocity_relevant, pressure_relevant;
+    DoFTools::extract_locally_relevant_dofs(dof_handler_velocity, velocity_relevant);
+    DoFTools::extract_locally_relevant_dofs(dof_handler_pressure, pressure_relevant);
+    velocity_constraints.clear();
+    velocity_constraints.reinit(velocity_relevant);
+    pressure_constraints.clear();
+    pressure_constraints.reinit(pressure_relevant);
+    for (const auto &line : constraints.get_lines())
+    {
+      const bool velocity_line = line.index < n_u;
+      AffineConstraints<double> &block_constraints =
+          velocity_line ? velocity_constraints : pressure_constraints;
+      const types::global_dof_index offset = velocity_line ? 0 : n_u;
+      if (!(velocity_line ? velocity_relevant : pressure_relevant).is_element(line.index - offset))
+        continue;
+
+      block_constraints.add_line(line.index - offset);
+      for (const auto &[column, value] : line.entries)
+        block_constraints.add_entry(line.index - offset, column - offset, value);
+      block_constraints.set_inhomogeneity(line.index - offset, line.inhomogeneity);
+    }
+    velocity_constraints.close();
+    pressure_constraints.close();
+
+    typename MatrixFree<dim, double>::AdditionalData data;
+    data.mapping_update_flags = update_values | update_gradients | update_JxW_values;
+    const std::vector<const DoFHandler<dim> *> dof_handlers = {&dof_handler_velocity,
+                                                               &dof_handler_pressure};
+    const std::vector<const AffineConstraints<double> *> block_constraints = {&velocity_constraints,
+                                                                              &pressure_constraints};
+    matrix_free.reinit(MappingQGeneric<dim>(1), dof_handlers, block_constraints,
+                       QGauss<1>(n_q_points_1d), data);
+    initialize_dof_vector(src_mf);
+    initialize_dof_vector(dst_mf);
+
+    // Locally owned constrained DoFs, by block.
+    constrained_dofs.clear();
+    for (unsigned int block = 0; block < 2; ++block)
+    {
+      const DoFHandler<dim> &block_dof_handler = block == 0 ? dof_handler_velocity : dof_handler_pressure;
+      const types::global_dof_index offset = block == 0 ? 0 : n_u;
+      const IndexSet &owned_dofs = block_dof_handler.locally_owned_dofs();
+      for (unsigned int i = 0; i < owned_dofs.n_elements(); ++i)
+        if (constraints.is_constrained(owned_dofs.nth_index_in_set(i) + offset))
+          constrained_dofs.push_back({block, i, owned_dofs.nth_index_in_set(i)});
+    }
+    constrained_diagonal.resize(constrained_dofs.size());
+  }
+
+  // Evaluate the convective velocity at the quadrature points, from the
+  // solution with ghost entries the convection matrix was assembled with.
+  void
+  set_convective_velocity(const LinearAlgebra::distributed::BlockVector<double> &w,
+                          const bool &with_mass_)
+  {
+    with_mass = with_mass_;
+
+    copy_owned(w, src_mf);
+    src_mf.update_ghost_values();
+
+    FEEvaluation<dim, degree_velocity, n_q_points_1d, dim, double> velocity(matrix_free, 0, 0);
+    const unsigned int n_q = velocity.n_q_points;
+    convective_velocity.resize(matrix_free.n_cell_batches() * n_q);
+    convective_divergence.resize(matrix_free.n_cell_batches() * n_q);
+
+    for (unsigned int cell = 0; cell < matrix_free.n_cell_batches(); ++cell)
+    {
+      velocity.reinit(cell);
+      // Plain values: the Dirichlet data are part of w.
+      velocity.read_dof_values_plain(src_mf.block(0));
+      velocity.evaluate(EvaluationFlags::values | EvaluationFlags::gradients);
+      for (unsigned int q = 0; q < n_q; ++q)
+      {
+        convective_velocity[cell * n_q + q] = velocity.get_value(q);
+        convective_divergence[cell * n_q + q] = velocity.get_divergence(q);
+      }
+    }
+    src_mf.zero_out_ghost_values();
+  }
+
+  // Copy the diagonal entries of the constrained rows.
+  void
+  set_constrained_diagonal(const TrilinosWrappers::BlockSparseMatrix &system_matrix)
+  {
+    for (unsigned int k = 0; k < constrained_dofs.size(); ++k)
+      constrained_diagonal[k] = system_matrix.block(constrained_dofs[k].block, constrained_dofs[k].block)
+                                    .diag_element(constrained_dofs[k].index);
+  }
+
+  void
+  vmult(TrilinosWrappers::MPI::BlockVector &dst,
+        const TrilinosWrappers::MPI::BlockVector &src) const
+  {
+    copy_owned(src, src_mf);
+    matrix_free.cell_loop(&MatrixFreeOseenOperator::local_apply, this, dst_mf, src_mf, true);
+
+    for (unsigned int k = 0; k < constrained_dofs.size(); ++k)
+    {
+      const ConstrainedDoF &dof = constrained_dofs[k];
+      dst_mf.block(dof.block).local_element(dof.local_index) =
+          constrained_diagonal[k] * src_mf.block(dof.block).local_element(dof.local_index);
+    }
+
+    for (unsigned int block = 0; block < dst.n_blocks(); ++block)
+    {
+      Epetra_MultiVector &dst_epetra = dst.block(block).trilinos_vector();
+      AssertDimension(static_cast<unsigned int>(dst_epetra.MyLength()),
+                      dst_mf.block(block).locally_owned_size());
+      std::copy(dst_mf.block(block).begin(), dst_mf.block(block).begin() + dst_epetra.MyLength(),
+                dst_epetra[0]);
+    }
+  }
+
+protected:
+  // DoF handlers of the velocity and of the pressure, numbered as the
+  // blocks of the system: each DoF of a block takes the number (within the
+  // block) of the system DoF at the same place of the locally owned cells.
+  void
+  setup_block_dof_handlers(const DoFHandler<dim> &dof_handler)
+  {
+    const FiniteElement<dim> &fe = dof_handler.get_fe();
+    dof_handler_velocity.reinit(dof_handler.get_triangulation());
+    dof_handler_velocity.distribute_dofs(fe_velocity);
+    dof_handler_pressure.reinit(dof_handler.get_triangulation());
+    dof_handler_pressure.distribute_dofs(fe_pressure);
+    const types::global_dof_index n_u = dof_handler_velocity.n_dofs();
+
+    const IndexSet &velocity_owned = dof_handler_velocity.locally_owned_dofs();
+    const IndexSet &pressure_owned = dof_handler_pressure.locally_owned_dofs();
+    std::vector<types::global_dof_index> velocity_numbers(velocity_owned.n_elements());
+    std::vector<types::global_dof_index> pressure_numbers(pressure_owned.n_elements());
+    std::vector<types::global_dof_index> dof_indices(fe.dofs_per_cell);
+    std::vector<types::global_dof_index> velocity_indices(fe_velocity.dofs_per_cell);
+    std::vector<types::global_dof_index> pressure_indices(fe_pressure.dofs_per_cell);
+
+    auto velocity_cell = dof_handler_velocity.begin_active();
+    auto pressure_cell = dof_handler_pressure.begin_active();
+    for (const auto &cell : dof_handler.active_cell_iterators())
+    {
+      if (cell->is_locally_owned())
+      {
+        cell->get_dof_indices(dof_indices);
+        velocity_cell->get_dof_indices(velocity_indices);
+        pressure_cell->get_dof_indices(pressure_indices);
+
+        for (unsigned int i = 0; i < fe_velocity.dofs_per_cell; ++i)
+          if (velocity_owned.is_element(velocity_indices[i]))
+          {
+            const auto [component, base_index] = fe_velocity.system_to_component_index(i);
+            velocity_numbers[velocity_owned.index_within_set(velocity_indices[i])] =
+                dof_indices[fe.component_to_system_index(component, base_index)];
+          }
+        for (unsigned int i = 0; i < fe_pressure.dofs_per_cell; ++i)
+          if (pressure_owned.is_element(pressure_indices[i]))
+            pressure_numbers[pressure_owned.index_within_set(pressure_indices[i])] =
+                dof_indices[fe.component_to_system_index(dim, i)] - n_u;
+      }
+      ++velocity_cell;
+      ++pressure_cell;
+    }
+
+    dof_handler_velocity.renumber_dofs(velocity_numbers);
+    dof_handler_pressure.renumber_dofs(pressure_numbers);
+    Assert(dof_handler_velocity.locally_owned_dofs() ==
+               dof_handler.locally_owned_dofs().get_view(0, n_u),
+           ExcMessage("The velocity DoFs must have the owners of the system DoFs."));
+    Assert(dof_handler_pressure.locally_owned_dofs() ==
+               dof_handler.locally_owned_dofs().get_view(n_u, dof_handler.n_dofs()),
+           ExcMessage("The pressure DoFs must have the owners of the system DoFs."));
+  }
+
+  void
+  initialize_dof_vector(VectorType &vector) const
+  {
+    vector.reinit(2);
+    matrix_free.initialize_dof_vector(vector.block(0), 0);
+    matrix_free.initialize_dof_vector(vector.block(1), 1);
+    vector.collect_sizes();
+  }
+
+  // The locally owned entries of each block are those of the Trilinos
+  // blocks, in the same order.
+  template <typename BlockVectorType>
+  static void
+  copy_owned(const BlockVectorType &src, VectorType &dst)
+  {
+    for (unsigned int block = 0; block < src.n_blocks(); ++block)
+    {
+      const auto &src_block = src.block(block);
+      AssertDimension(src_block.locally_owned_size(), dst.block(block).locally_owned_size());
+      std::copy(src_block.begin(), src_block.begin() + src_block.locally_owned_size(),
+                dst.block(block).begin());
+    }
+  }
+
+  void
+  local_apply(const MatrixFree<dim, double> &data,
+              VectorType &dst,
+              const VectorType &src,
+              const std::pair<unsigned int, unsigned int> &cell_range) const
+  {
+    FEEvaluation<dim, degree_velocity, n_q_points_1d, dim, double> velocity(data, 0, 0);
+    FEEvaluation<dim, degree_pressure, n_q_points_1d, 1, double> pressure(data, 1, 0);
+    const unsigned int n_q = velocity.n_q_points;
+
+    for (unsigned int cell = cell_range.first; cell < cell_range.second; ++cell)
+    {
+      velocity.reinit(cell);
+      pressure.reinit(cell);
+      velocity.gather_evaluate(src.block(0), EvaluationFlags::values | EvaluationFlags::gradients);
+      pressure.gather_evaluate(src.block(1), EvaluationFlags::values);
+
+      for (unsigned int q = 0; q < n_q; ++q)
+      {
+        const Tensor<1, dim, Number> u = velocity.get_value(q);
+        const Tensor<2, dim, Number> grad_u = velocity.get_gradient(q);
+        const Number p = pressure.get_value(q);
+
+        // Convection (w . grad) u and Temam term 0.5 div(w) u, with the
+        // mass term: tested against v.
+        Tensor<1, dim, Number> value_term =
+            grad_u * convective_velocity[cell * n_q + q] +
+            0.5 * convective_divergence[cell * n_q + q] * u;
+        if (with_mass)
+          value_term += u / deltat;
+
+        // Viscosity, grad-div and pressure: tested against grad v.
+        Tensor<2, dim, Number> gradient_term = nu * grad_u;
+        const Number div_term = grad_div * trace(grad_u) - p;
+        for (unsigned int d = 0; d < dim; ++d)
+          gradient_term[d][d] += div_term;
+
+        velocity.submit_value(value_term, q);
+        velocity.submit_gradient(gradient_term, q);
+
+        // Continuity: tested against q.
+        pressure.submit_value(trace(grad_u), q);
+      }
+
+      velocity.integrate_scatter(EvaluationFlags::values | EvaluationFlags::gradients, dst.block(0));
+      pressure.integrate_scatter(EvaluationFlags::values, dst.block(1));
+    }
+  }
+
+  double nu = 0.0;
+  double deltat = 1.0;
+  double grad_div = 0.0;
+  bool with_mass = true;
+
+  // Block DoF handlers and their constraints (declared before the
+  // MatrixFree object, which refers to them).
+  FESystem<dim> fe_velocity;
+  FE_Q<dim> fe_pressure;
+  DoFHandler<dim> dof_handler_velocity;
+  DoFHandler<dim> dof_handler_pressure;
+  AffineConstraints<double> velocity_constraints;
+  AffineConstraints<double> pressure_constraints;
+
+  MatrixFree<dim, double> matrix_free;
+
+  // Convective velocity and its divergence, by cell batch and quadrature
+  // point.
+  std::vector<Tensor<1, dim, Number>> convective_velocity;
+  std::vector<Number> convective_divergence;
+
+  // Locally owned constrained DoFs (block, local and global index within
+  // the block) and their diagonal entries.
+  struct ConstrainedDoF
+  {
+    unsigned int block;
+    unsigned int local_index;
+    types::global_dof_index index;
+  };
+  std::vector<ConstrainedDoF> constrained_dofs;
+  std::vector<double> constrained_diagonal;
+
+  // Vectors with the layout of the matrix-free loops.
+  mutable VectorType src_mf;
+  mutable VectorType dst_mf;
+};
+
+#endif
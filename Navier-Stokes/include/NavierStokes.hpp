@@ -0,0 +1,688 @@
+#ifndef NAVIER_STOKES_HPP
+#define NAVIER_STOKES_HPP
+
+#include "AdaptiveTolerance.hpp"
+#include "AssemblyKernels.hpp"
+#include "MatrixFreeOperator.hpp"
+#include "Preconditioners.hpp"
+#include "SolverGCRODR.hpp"
+#include "SolverPipelined.hpp"
+#include "SolverEnsembleGMRES.hpp"
+#include "SparseDirectSolver.hpp"
+#include "PreconditionerAutotuner.hpp"
+#include "ProblemDescription.hpp"
+#include "IncludesFile.hpp"
+
+
+using namespace dealii;
+
+// Class implementing a solver for the unsteady Navier-Stokes problem. The
+// problem data (boundary conditions, exact solution, post-processing) come
+// from a ProblemDescription, so the same class serves the 2D and 3D flow past
+// a cylinder and the 3D convergence study. The solver runs on the given
+// communicator, so that several instances can run side by side on
+// sub-communicators (ensemble runs).
+template <int dim>
+class NavierStokes
+{
+public:
+  // Treatment of the convective term at each time step: semi-implicit (one
+  // linear solve with C(u^n)), or fully implicit with Picard (Oseen) or
+  // Newton iterations.
+  enum class NonlinearSolver
+  {
+    semi_implicit,
+    picard,
+    newton
+  };
+
+  NavierStokes(ProblemDescription<dim> &problem_,
+               const std::string &mesh_file_name_,
+               const unsigned int &degree_velocity_,
+               const unsigned int &degree_pressure_,
+               const double &T_,
+               const double &deltat_,
+               const MPI_Comm &mpi_communicator_ = MPI_COMM_WORLD)
+    : problem(problem_),
+      mpi_communicator(mpi_communicator_),
+      mpi_size(Utilities::MPI::n_mpi_processes(mpi_communicator_)),
+      mpi_rank(Utilities::MPI::this_mpi_process(mpi_communicator_)),
+      pcout(std::cout, mpi_rank == 0),
+      nu(problem_.viscosity()),
+      rho(problem_.density()),
+      T(T_),
+      mesh_file_name(mesh_file_name_),
+      degree_velocity(degree_velocity_),
+      degree_pressure(degree_pressure_),
+      deltat(deltat_),
+      cell_assembler(degree_velocity_, degree_pressure_)
+  {
+  }
+
+  ~NavierStokes()
+  {
+    if (comm_sm != MPI_COMM_SELF)
+      MPI_Comm_free(&comm_sm);
+  }
+
+  // Parameters of the adaptive mesh refinement.
+  struct AdaptiveRefinement
+  {
+    AdaptiveRefinement(const unsigned int &interval_ = 10,
+                       const double &refine_fraction_ = 0.3,
+                       const double &coarsen_fraction_ = 0.03,
+                       const unsigned int &initial_refinements_ = 1,
+                       const unsigned int &max_level_ = 4)
+      : interval(interval_)
+      , refine_fraction(refine_fraction_)
+      , coarsen_fraction(coarsen_fraction_)
+      , initial_refinements(initial_refinements_)
+      , max_level(max_level_)
+    {
+    }
+
+    // Time steps between two adaptations.
+    unsigned int interval;
+
+    // Fractions of the cells refined and coarsened by an adaptation.
+    double refine_fraction;
+    double coarsen_fraction;
+
+    // Global refinements of the coarse mesh (the cells are never coarsened
+    // below them) and maximum refinement level.
+    unsigned int initial_refinements;
+    unsigned int max_level;
+  };
+
+  // Setup system.
+  void
+  setup();
+
+  // Solve system.
+  void
+  solve();
+
+  // Solve the steady problem (no time derivative) with Picard/Newton
+  // iterations, the data of the problem are taken at time 0.
+  void
+  solve_steady();
+
+  // Solve the ensemble set by enable_ensemble() with the semi-implicit
+  // scheme: one system matrix per time step for all the members, one
+  // right-hand side each.
+  void
+  solve_ensemble();
+
+  // Autotune the preconditioner (and its inner tolerance) during the first
+  // time steps, reusing a previous selection from the log when available.
+  void
+  enable_autotuning(const unsigned int &n_trial_steps = 2);
+
+  // Choose the block preconditioner: 0 Yosida, 1 SIMPLE, 2 aYosida, 3 aSIMPLE,
+  // 4 augmented Lagrangian (with the grad-div term, see enable_grad_div()).
+  void
+  set_preconditioner_type(const unsigned int &preconditioner_type_)
+  {
+    preconditioner_type = preconditioner_type_;
+  }
+
+  // Choose the treatment of the convective term. With Newton, the first
+  // n_picard_iterations_ iterations of each nonlinear solve are Picard ones.
+  void
+  set_nonlinear_solver(const NonlinearSolver &nonlinear_solver_,
+                       const unsigned int &n_picard_iterations_ = 1,
+                       const unsigned int &max_nonlinear_iterations_ = 20,
+                       const double &nonlinear_tolerance_ = 1e-8)
+  {
+    nonlinear_solver = nonlinear_solver_;
+    n_picard_iterations = n_picard_iterations_;
+    max_nonlinear_iterations = max_nonlinear_iterations_;
+    nonlinear_tolerance = nonlinear_tolerance_;
+  }
+
+  // Solve the outer system with the recycling solver GCRO-DR instead of
+  // GMRES, keeping n_recycled_vectors harmonic Ritz vectors from one solve to
+  // the next.
+  void
+  enable_krylov_recycling(const unsigned int &n_recycled_vectors = 5,
+                          const unsigned int &max_basis_size = 30)
+  {
+    krylov_recycling = true;
+    gcrodr_data = SolverGCRODR::AdditionalData(max_basis_size, n_recycled_vectors);
+    recycle_space.clear();
+  }
+
+  // Start each time step from the extrapolation 2 u^n - u^{n-1} instead of
+  // u^n (enabled by default).
+  void
+  set_initial_guess_extrapolation(const bool &extrapolate_initial_guess_)
+  {
+    extrapolate_initial_guess = extrapolate_initial_guess_;
+  }
+
+  // Choose the outer and inner tolerances of each linear solve with the
+  // Eisenstat-Walker policy of AdaptiveTolerance instead of the fixed 1e-4
+  // (absolute) and 1e-2 (relative), the inner tolerance being relaxed along
+  // the outer iterations. The outer solve then uses flexible GMRES (unless
+  // the low synchronization or recycling solver, also flexible, is chosen).
+  // The tolerances of every solve are recorded in outer_tolerances,
+  // inner_tolerances and in "tolerances.csv".
+  void
+  enable_adaptive_tolerances(
+    const AdaptiveTolerance::AdditionalData &data = AdaptiveTolerance::AdditionalData())
+  {
+    adaptive_tolerance = std::make_unique<AdaptiveTolerance>(data);
+  }
+
+  // Solve each linear system with a sparse direct solver (Amesos_Klu,
+  // Amesos_Mumps, ...) instead of preconditioned GMRES. To be called before
+  // setup(), which performs the symbolic factorization.
+  void
+  enable_direct_solver(const std::string &solver_type = "Amesos_Klu")
+  {
+    direct_solver = std::make_unique<SparseDirectSolver>(solver_type);
+  }
+
+  // Share the ghost entries of the solution vectors between the processes of
+  // the same node through MPI-3 shared memory windows: the ghost exchange
+  // within a node becomes a memory read. To be called before setup().
+  void
+  enable_shared_memory_ghosts()
+  {
+    shared_memory_ghosts = true;
+  }
+
+  // Use the low synchronization solvers: flexible GMRES with one blocking
+  // reduction per iteration for the outer solve (unless recycling),
+  // pipelined GMRES for the inner F solves and pipelined CG for the inner
+  // Schur solves, whose reductions overlap the products.
+  void
+  set_low_synchronization_solvers(const bool &low_synchronization_)
+  {
+    low_synchronization = low_synchronization_;
+  }
+
+  // Run the inner F and Schur solves of the block preconditioners with
+  // single precision ILU factors, the outer solve staying in double.
+  void
+  set_mixed_precision(const bool &mixed_precision_)
+  {
+    mixed_precision = mixed_precision_;
+  }
+
+  // Solve on the hexahedral mesh of the problem (ProblemDescription::
+  // make_hex_mesh, refined n_refinements times) with Q_k elements, instead of
+  // the simplex mesh file. To be called before setup().
+  void
+  use_hex_mesh(const unsigned int &n_refinements = 1)
+  {
+    hex_mesh = true;
+    n_hex_refinements = n_refinements;
+    cell_assembler = CellAssembler<dim>(degree_velocity, degree_pressure, false);
+  }
+
+  // Solve on the hexahedral mesh and adapt it every data.interval time steps
+  // to the Kelly indicator of the velocity. The solution is transferred to
+  // the new mesh, which is repartitioned. To be called before setup().
+  void
+  enable_adaptive_refinement(const AdaptiveRefinement &data = AdaptiveRefinement())
+  {
+    use_hex_mesh(data.initial_refinements);
+    adaptive_refinement = std::make_unique<AdaptiveRefinement>(data);
+  }
+
+  // Apply the system matrix of the outer solve matrix-free, with sum
+  // factorization (MatrixFreeOperator.hpp). Needs the hexahedral mesh and
+  // Q2/Q1 elements; Newton iterations and backflow stabilization still use
+  // the assembled matrix. The B blocks are assembled once per mesh for the
+  // preconditioners, and each step only updates the convection in the F
+  // block. To be called before setup().
+  void
+  enable_matrix_free()
+  {
+    AssertThrow(hex_mesh, ExcMessage("The matrix-free operator needs the hexahedral mesh."));
+    AssertThrow(degree_velocity == 2 && degree_pressure == 1,
+                ExcMessage("The matrix-free operator is instantiated for Q2/Q1 only."));
+    matrix_free_operator = std::make_unique<MatrixFreeOseenOperator<dim, 2, 1>>();
+  }
+
+  // Stabilize the equal order P1/P1 (Q1/Q1 on the hexahedral mesh) elements
+  // with PSPG, and optionally SUPG for the convection (StabilizationKernel in
+  // AssemblyKernels.hpp). The system gets a pressure-pressure block, which
+  // is added to the Schur complement approximations of the preconditioners.
+  // To be called before setup().
+  void
+  enable_stabilization(const bool &supg_ = false)
+  {
+    AssertThrow(degree_velocity == 1 && degree_pressure == 1,
+                ExcMessage("The stabilization is meant for P1/P1 elements."));
+    stabilization = true;
+    supg = supg_;
+  }
+
+  // Add the grad-div term gamma (div u, div v) to the stiffness matrix. The
+  // Schur complement then gets close to Mp / (nu + gamma), which is the
+  // approximation of the augmented Lagrangian preconditioner. To be called
+  // before setup().
+  void
+  enable_grad_div(const double &gamma = 1.0)
+  {
+    AssertThrow(gamma > 0., ExcMessage("The grad-div parameter must be positive."));
+    grad_div = gamma;
+  }
+
+  // Precondition F with one scalar factorization applied to each velocity
+  // component (block diagonal approximation, see PreconditionInner) instead
+  // of a factorization of the whole velocity block. Not available with the
+  // grad-div term, which differs between the components. To be called
+  // before setup().
+  void
+  enable_component_preconditioner()
+  {
+    component_preconditioner = true;
+  }
+
+  // Solve an ensemble of flows on the same mesh, the k-th member having the
+  // Dirichlet data and the initial condition of the problem scaled by
+  // dirichlet_scalings[k]. The convection is linearized around the ensemble
+  // mean (Jiang-Layton), so that the members share the system matrix and
+  // its factorization or preconditioner. To be called before setup().
+  void
+  enable_ensemble(const std::vector<double> &dirichlet_scalings)
+  {
+    AssertThrow(!dirichlet_scalings.empty(), ExcMessage("The ensemble has no member."));
+    ensemble.resize(dirichlet_scalings.size());
+    for (unsigned int k = 0; k < ensemble.size(); ++k)
+      ensemble[k].scaling = dirichlet_scalings[k];
+    ensemble_drag_coeff.assign(ensemble.size(), std::vector<double>());
+    ensemble_lift_coeff.assign(ensemble.size(), std::vector<double>());
+  }
+
+  // Prefix of the log files (gmres.csv, tolerances.csv and autotune.csv), to
+  // tell apart the instances of an ensemble.
+  void
+  set_log_prefix(const std::string &log_prefix_)
+  {
+    log_prefix = log_prefix_;
+  }
+
+  // Compute the error against the exact solution of the problem.
+  double
+  compute_error(const VectorTools::NormType &norm_type);
+
+  std::vector<double> vec_drag;
+  std::vector<double> vec_lift;
+  std::vector<double> vec_drag_coeff;
+  std::vector<double> vec_lift_coeff;
+
+  // Drag and lift coefficients of each member of the ensemble, relative to
+  // its own reference force (scaling^2 times that of the problem).
+  std::vector<std::vector<double>> ensemble_drag_coeff;
+  std::vector<std::vector<double>> ensemble_lift_coeff;
+
+  std::vector<double> time_prec;
+  std::vector<double> time_solve;
+
+  // Outer (absolute) and initial inner (relative) tolerances of each
+  // linear solve.
+  std::vector<double> outer_tolerances;
+  std::vector<double> inner_tolerances;
+
+protected:
+  // Assemble system the first time to create mass-stiffness matrixes
+  void
+  assemble(const double &time);
+  // Assemble at each time step to only compute the convection matrix that changes overtime
+  // (and the right-hand side, unless with_rhs is false)
+  void
+  assemble_time_step(const double &time, const bool &with_rhs = true);
+
+  // Assemble the linearized system of one Picard or Newton iteration around
+  // the current iterate (solution), the previous time step being stored in
+  // previous_solution. The system is written for the new iterate itself, so
+  // the Dirichlet data are imposed as they are.
+  void
+  assemble_nonlinear_step(const double &time, const bool &newton, const bool &steady);
+
+  // Solve the nonlinear problem of one time step (or the steady problem).
+  void
+  solve_nonlinear(const double &time, const bool &steady);
+
+  // Interpolate the spatial profiles of separable Dirichlet data once.
+  void
+  setup_dirichlet_profiles();
+
+  // Set up the constraints at the current time: hanging nodes, periodicity
+  // and the Dirichlet data of the problem. They are imposed while the cell
+  // contributions are distributed to the system.
+  void
+  update_constraints();
+
+  // Same, into the given constraints and with the Dirichlet data scaled.
+  void
+  update_constraints(AffineConstraints<double> &target, const double &dirichlet_scaling) const;
+
+  // Add the right-hand side of a cell to the system. On cells with
+  // constrained DoFs, the lifting of the Dirichlet data uses the whole cell
+  // matrix: its static part, stored by assemble(), plus the given
+  // convection matrix.
+  void
+  distribute_cell_rhs(const typename DoFHandler<dim>::active_cell_iterator &cell,
+                      const std::vector<types::global_dof_index> &dof_indices,
+                      const Vector<double> &cell_rhs,
+                      const FullMatrix<double> &cell_convection_matrix,
+                      const bool &with_mass,
+                      FullMatrix<double> &cell_matrix);
+
+  // Same, with the given constraints and into the given right-hand side.
+  void
+  distribute_cell_rhs(const typename DoFHandler<dim>::active_cell_iterator &cell,
+                      const std::vector<types::global_dof_index> &dof_indices,
+                      const Vector<double> &cell_rhs,
+                      const FullMatrix<double> &cell_convection_matrix,
+                      const bool &with_mass,
+                      FullMatrix<double> &cell_matrix,
+                      const AffineConstraints<double> &cell_constraints,
+                      TrilinosWrappers::MPI::BlockVector &rhs);
+
+  // Assemble the right-hand side of each member of the ensemble, solution
+  // holding the ensemble mean.
+  void
+  assemble_ensemble_rhs(const double &time);
+
+  // Solve the systems of all the members of the ensemble.
+  void
+  solve_ensemble_time_step(const double &time);
+
+  // Set solution to the mean of the members of the ensemble.
+  void
+  update_ensemble_mean();
+
+  // Initialize the DoF handler, the constraints and the linear system on the
+  // current mesh.
+  void
+  setup_system();
+
+  // Adapt the mesh and transfer the solutions (u^n and u^{n-1}) to it.
+  void
+  refine_mesh();
+
+  // Add a cell convection matrix to the convection matrix. With the
+  // matrix-free operator only its velocity-velocity part is added, to the F
+  // block: the assembled system is then only the input of the
+  // preconditioners, and its B blocks do not change in time.
+  void
+  distribute_cell_convection(const FullMatrix<double> &cell_convection_matrix,
+                             const std::vector<types::global_dof_index> &dof_indices);
+
+  // Add factor times the convection matrix to the system matrix (to its F
+  // block only with the matrix-free operator).
+  void
+  add_convection_to_system(const double &factor);
+
+  // Update the matrix-free operator to the system just assembled, the
+  // solution being the linearization point.
+  void
+  update_matrix_free_operator(const bool &with_mass, const bool &newton);
+
+  // Solve the problem for one time step. With ensemble_lockstep, the
+  // systems of all the members of the ensemble are solved together, with
+  // SolverEnsembleGMRES, instead of the system of solution_owned.
+  void
+  solve_time_step(const double &time, const bool &ensemble_lockstep = false);
+
+  // Output results.
+  void
+  output(const unsigned int &time_step) const;
+
+  // Copy the locally owned entries of the solver vector into a vector with
+  // ghost entries and update them.
+  void
+  copy_to_ghosted(const TrilinosWrappers::MPI::BlockVector &src,
+                  LinearAlgebra::distributed::BlockVector<double> &dst) const;
+
+  // Copy the locally owned entries of a vector with ghost entries into a
+  // solver vector (no communication).
+  void
+  copy_to_owned(const LinearAlgebra::distributed::BlockVector<double> &src,
+                TrilinosWrappers::MPI::BlockVector &dst) const;
+
+  // Compute drag and lift on the obstacle, returns the coefficients.
+  std::vector<double>
+  compute_forces();
+
+  // Drag and lift of the given solution on the obstacle.
+  std::vector<double>
+  integrate_forces(const LinearAlgebra::distributed::BlockVector<double> &flow) const;
+
+  void
+  compute_pressure_difference();
+
+  // Problem definition. ///////////////////////////////////////////////////////
+
+  // Boundary conditions, data and post-processing of the problem.
+  ProblemDescription<dim> &problem;
+
+  // MPI parallel. /////////////////////////////////////////////////////////////
+
+  // Communicator of the solver.
+  const MPI_Comm mpi_communicator;
+
+  // Number of MPI processes.
+  const unsigned int mpi_size;
+
+  // This MPI process.
+  const unsigned int mpi_rank;
+
+  // Parallel output stream.
+  ConditionalOStream pcout;
+
+  // Kinematic viscosity [m2/s].
+  const double nu;
+
+  // Density
+  const double rho;
+
+  // Final time.
+  const double T;
+
+  // Discretization. ///////////////////////////////////////////////////////////
+
+  // Mesh file name.
+  const std::string mesh_file_name;
+
+  // Polynomial degree used for velocity.
+  const unsigned int degree_velocity;
+
+  // Polynomial degree used for pressure.
+  const unsigned int degree_pressure;
+
+  // TIme step.
+  const double deltat;
+
+  // Local assembly, specialized at compile time for the common degrees.
+  CellAssembler<dim> cell_assembler;
+
+  // Mesh: fully distributed simplex mesh read from the mesh file, or
+  // distributed hexahedral mesh with adaptive refinement.
+  std::unique_ptr<parallel::DistributedTriangulationBase<dim>> mesh;
+
+  // Hexahedral mesh and its global refinements.
+  bool hex_mesh = false;
+  unsigned int n_hex_refinements = 0;
+
+  // Adaptive refinement (null if the mesh is fixed).
+  std::unique_ptr<AdaptiveRefinement> adaptive_refinement;
+
+  // The static matrices have to be assembled (first step, new mesh).
+  bool static_matrices_outdated = true;
+
+  // PSPG stabilization of equal order elements, with SUPG.
+  bool stabilization = false;
+  bool supg = false;
+
+  // Grad-div parameter gamma (zero if the term is not added).
+  double grad_div = 0.0;
+
+  // Finite element space.
+  std::unique_ptr<FiniteElement<dim>> fe;
+
+  // Quadrature formula.
+  std::unique_ptr<Quadrature<dim>> quadrature;
+
+  // Quadrature formula used on boundary lines.
+  std::unique_ptr<Quadrature<dim - 1>> quadrature_boundary;
+
+  // DoF handler.
+  DoFHandler<dim> dof_handler;
+
+  // DoFs owned by current process.
+  IndexSet locally_owned_dofs;
+
+  // DoFs owned by current process in the velocity and pressure blocks.
+  std::vector<IndexSet> block_owned_dofs;
+
+  // DoFs relevant to the current process (including ghost DoFs).
+  IndexSet locally_relevant_dofs;
+
+  // DoFs relevant to current process in the velocity and pressure blocks.
+  std::vector<IndexSet> block_relevant_dofs;
+
+  // Locally relevant Dirichlet DoFs and the spatial profile of the datum on
+  // them, for separable Dirichlet data.
+  bool separable_dirichlet = false;
+  std::vector<types::global_dof_index> dirichlet_dofs;
+  std::vector<double> dirichlet_profile;
+
+  // Hanging node and periodicity constraints, which do not change in time.
+  AffineConstraints<double> static_constraints;
+
+  // Constraints at the current time (static ones and Dirichlet data).
+  AffineConstraints<double> constraints;
+
+  // Static part of the cell matrix (without and with the mass) of the cells
+  // with constrained DoFs, by active cell index.
+  std::map<unsigned int, FullMatrix<double>> constrained_cell_matrices;
+  std::map<unsigned int, FullMatrix<double>> constrained_cell_mass_matrices;
+
+  // System matrix.
+  TrilinosWrappers::BlockSparseMatrix system_matrix;
+  // Stiffness Matrix
+  TrilinosWrappers::BlockSparseMatrix stiffness_matrix;
+  // Mass Matrix
+  TrilinosWrappers::BlockSparseMatrix mass_matrix;
+  // Convection matrix at step (u_k)
+  TrilinosWrappers::BlockSparseMatrix convection_matrix;
+
+  // Pressure mass matrix, needed for preconditioning, also referred as Mp
+  TrilinosWrappers::BlockSparseMatrix pressure_mass;
+
+  // Right-hand side vector in the linear system.
+  TrilinosWrappers::MPI::BlockVector system_rhs;
+
+  // System solution (without ghost elements).
+  TrilinosWrappers::MPI::BlockVector solution_owned;
+
+  // System solution (including ghost elements). The vectors with ghost
+  // elements are deal.II vectors, which can share the ghost entries within a
+  // node, the solver works on the Trilinos ones.
+  LinearAlgebra::distributed::BlockVector<double> solution;
+
+  // Solution at the previous time step (including ghost elements).
+  LinearAlgebra::distributed::BlockVector<double> previous_solution;
+
+  // Solution at the previous time step (without ghost elements), used for
+  // the extrapolated initial guess.
+  TrilinosWrappers::MPI::BlockVector old_solution_owned;
+
+  // Residual of the initial guess of the outer solve (without ghost elements).
+  TrilinosWrappers::MPI::BlockVector outer_residual;
+
+  // Solver. ///////////////////////////////////////////////////////////////////
+
+  // Block preconditioner used when the autotuning is disabled.
+  unsigned int preconditioner_type = 0;
+
+  // Shared memory ghost entries, with the communicator of the node.
+  bool shared_memory_ghosts = false;
+  MPI_Comm comm_sm = MPI_COMM_SELF;
+
+  // Single precision inner preconditioners.
+  bool mixed_precision = false;
+
+  // Low synchronization outer and inner solvers.
+  bool low_synchronization = false;
+
+  // Extrapolate the initial guess of each time step.
+  bool extrapolate_initial_guess = true;
+
+  // Treatment of the convective term.
+  NonlinearSolver nonlinear_solver = NonlinearSolver::semi_implicit;
+
+  // Picard iterations done before switching to Newton.
+  unsigned int n_picard_iterations = 1;
+
+  // Maximum number of nonlinear iterations.
+  unsigned int max_nonlinear_iterations = 20;
+
+  // Relative tolerance on the nonlinear residual.
+  double nonlinear_tolerance = 1e-8;
+
+  // Component-wise preconditioning of F and layout of the velocity
+  // components.
+  bool component_preconditioner = false;
+  VelocityComponents velocity_components;
+
+  // Diagonals of the mass matrix and of F shared by the preconditioners.
+  OperatorDiagonals operator_diagonals;
+
+  // Block preconditioners. They are kept from one time step to the next so
+  // that their Schur complement approximations reuse the sparsity.
+  PreconditionYosida yosida;
+  PreconditionSIMPLE simple;
+  PreconditionaYosida ayosida;
+  PreconditionaSIMPLE asimple;
+  PreconditionAugmentedLagrangian augmented_lagrangian;
+
+  // Outer solver: GMRES, or GCRO-DR with a recycled subspace.
+  bool krylov_recycling = false;
+  SolverGCRODR::AdditionalData gcrodr_data;
+  SolverGCRODR::RecycleSpace recycle_space;
+
+  // Sparse direct solver (null if the systems are solved iteratively).
+  std::unique_ptr<SparseDirectSolver> direct_solver;
+
+  // Member of an ensemble: its Dirichlet data are those of the problem
+  // scaled by `scaling`.
+  struct EnsembleMember
+  {
+    double scaling = 1.0;
+    AffineConstraints<double> constraints;
+    TrilinosWrappers::MPI::BlockVector system_rhs;
+    TrilinosWrappers::MPI::BlockVector solution_owned;
+    LinearAlgebra::distributed::BlockVector<double> solution;
+  };
+  std::vector<EnsembleMember> ensemble;
+
+  // Matrix-free system operator of the outer solve (null if disabled), and
+  // whether it matches the system currently assembled.
+  std::unique_ptr<MatrixFreeOseenOperator<dim, 2, 1>> matrix_free_operator;
+  bool matrix_free_current = false;
+
+  // Local velocity DoFs of a cell, and workspace of the velocity-velocity
+  // convection updates of the matrix-free mode.
+  std::vector<unsigned int> velocity_local_dofs;
+  std::vector<types::global_dof_index> velocity_dof_indices;
+  FullMatrix<double> cell_velocity_matrix;
+
+  // Prefix of the log files.
+  std::string log_prefix;
+
+  // Adaptive tolerances (null if the tolerances are fixed).
+  std::unique_ptr<AdaptiveTolerance> adaptive_tolerance;
+
+  // Preconditioner autotuner (null if the autotuning is disabled).
+  std::unique_ptr<PreconditionerAutotuner> autotuner;
+};
+
+#endif
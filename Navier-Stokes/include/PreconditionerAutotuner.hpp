@@ -0,0 +1,203 @@
+#ifndef PRECONDITIONER_AUTOTUNER_HPP
+#define PRECONDITIONER_AUTOTUNER_HPP
+
+#include "IncludesFile.hpp"
+using namespace dealii;
+
+// Autotuner for the block preconditioner of the outer GMRES solve.
+//
+// The best choice among Yosida, SIMPLE, aYosida and aSIMPLE (and the
+// tolerance of their inner solves) depends on Re and on the mesh. The
+// autotuner runs a few trial time steps with each candidate, measures the
+// time per step (preconditioner setup + solve) and then locks in the fastest
+// one for the rest of the run. The first step of each preconditioner type
+// also pays its one-time setup (patterns of the Schur complement
+// approximation and of the factorizations), which would penalize the
+// candidate tried first: it is a warm-up step, logged but not timed. Every
+// trial is appended to a csv log, together
+// with the final choice, so that a later run with the same key can reuse the
+// selection without repeating the trials.
+class PreconditionerAutotuner
+{
+public:
+  // A preconditioner type (same numbering of solve_time_step) together with
+  // the relative tolerance of its inner solves.
+  struct Candidate
+  {
+    unsigned int preconditioner_type;
+    double inner_tolerance;
+  };
+
+  PreconditionerAutotuner(const std::vector<Candidate> &candidates_,
+                          const unsigned int &n_trial_steps_,
+                          const std::string &key_,
+                          const std::string &log_file_name_ = "autotune.csv",
+                          const MPI_Comm &mpi_communicator_ = MPI_COMM_WORLD)
+    : candidates(candidates_)
+    , n_trial_steps(n_trial_steps_)
+    , key(key_)
+    , log_file_name(log_file_name_)
+    , mpi_communicator(mpi_communicator_)
+    , mpi_rank(Utilities::MPI::this_mpi_process(mpi_communicator_))
+    , time_per_step(candidates_.size(), 0.0)
+  {
+    AssertThrow(!candidates.empty(), ExcMessage("No autotuning candidates."));
+    AssertThrow(n_trial_steps > 0, ExcMessage("At least one trial step is needed."));
+  }
+
+  // Default candidates: the four block preconditioners, each with a loose
+  // and a tight inner tolerance.
+  static std::vector<Candidate>
+  default_candidates()
+  {
+    std::vector<Candidate> default_list;
+    for (unsigned int type = 0; type < 4; ++type)
+      for (const double inner_tolerance : {1e-1, 1e-2})
+        default_list.push_back({type, inner_tolerance});
+    return default_list;
+  }
+
+  // Look for a previous selection with the same key in the log. If found,
+  // the autotuner is locked on it and no trial is performed.
+  bool
+  load()
+  {
+    int    found = 0;
+    int    type  = 0;
+    double inner_tolerance = 0.0;
+
+    if (mpi_rank == 0)
+    {
+      std::ifstream log_file(log_file_name);
+      std::string   line;
+      while (std::getline(log_file, line))
+      {
+        std::stringstream  line_stream(line);
+        std::string        entry;
+        std::vector<std::string> entries;
+        while (std::getline(line_stream, entry, ','))
+          entries.push_back(entry);
+
+        // Keep the last selection written for this key.
+        if (entries.size() >= 4 && entries[0] == key && entries[1] == "selected")
+        {
+          found = 1;
+          type = std::stoi(entries[2]);
+          inner_tolerance = std::stod(entries[3]);
+        }
+      }
+    }
+
+    MPI_Bcast(&found, 1, MPI_INT, 0, mpi_communicator);
+    MPI_Bcast(&type, 1, MPI_INT, 0, mpi_communicator);
+    MPI_Bcast(&inner_tolerance, 1, MPI_DOUBLE, 0, mpi_communicator);
+
+    if (found)
+    {
+      selected = {static_cast<unsigned int>(type), inner_tolerance};
+      locked = true;
+    }
+    return locked;
+  }
+
+  // True once the trials are over (or a selection has been loaded).
+  bool
+  is_locked() const
+  {
+    return locked;
+  }
+
+  // Candidate to be used for the next time step.
+  const Candidate &
+  current() const
+  {
+    return locked ? selected : candidates[current_candidate];
+  }
+
+  // Record the timings of a time step solved with current(). The slowest
+  // process defines the time per step, so that every process takes the same
+  // decision. The warm-up step of a preconditioner type does not count as
+  // a trial step of the candidate.
+  void
+  record(const double &time_prec,
+         const double &time_solve,
+         const unsigned int &n_iterations)
+  {
+    if (locked)
+      return;
+
+    const double time_step_prec = Utilities::MPI::max(time_prec, mpi_communicator);
+    const double time_step_solve = Utilities::MPI::max(time_solve, mpi_communicator);
+
+    const bool warm_up =
+        warmed_up_types.insert(candidates[current_candidate].preconditioner_type).second;
+
+    if (mpi_rank == 0)
+    {
+      std::ofstream log_file(log_file_name, std::ios::app);
+      log_file << key << (warm_up ? ",warmup," : ",trial,")
+               << candidates[current_candidate].preconditioner_type
+               << ',' << candidates[current_candidate].inner_tolerance << ','
+               << time_step_prec << ',' << time_step_solve << ',' << n_iterations << "\n";
+    }
+
+    if (warm_up)
+      return;
+
+    time_per_step[current_candidate] += (time_step_prec + time_step_solve) / n_trial_steps;
+
+    if (++current_trial_step < n_trial_steps)
+      return;
+
+    // Move on to the next candidate, or lock in the fastest one.
+    current_trial_step = 0;
+    if (++current_candidate < candidates.size())
+      return;
+
+    const unsigned int best = std::distance(time_per_step.begin(),
+                                            std::min_element(time_per_step.begin(),
+                                                             time_per_step.end()));
+    selected = candidates[best];
+    locked = true;
+
+    if (mpi_rank == 0)
+    {
+      std::ofstream log_file(log_file_name, std::ios::app);
+      log_file << key << ",selected," << selected.preconditioner_type << ','
+               << selected.inner_tolerance << ',' << time_per_step[best] << "\n";
+    }
+  }
+
+protected:
+  // Candidates to be tried, in order.
+  const std::vector<Candidate> candidates;
+
+  // Number of time steps solved with each candidate.
+  const unsigned int n_trial_steps;
+
+  // Identifier of the run (mesh, time step, ...) used to reuse a selection.
+  const std::string key;
+
+  // Csv file where trials and selections are logged.
+  const std::string log_file_name;
+
+  const MPI_Comm mpi_communicator;
+
+  const unsigned int mpi_rank;
+
+  // Mean time per step of each candidate.
+  std::vector<double> time_per_step;
+
+  // Preconditioner types whose warm-up step has been done.
+  std::set<unsigned int> warmed_up_types;
+
+  unsigned int current_candidate = 0;
+
+  unsigned int current_trial_step = 0;
+
+  bool locked = false;
+
+  Candidate selected = {0, 1e-2};
+};
+
+#endif
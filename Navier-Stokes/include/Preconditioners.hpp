@@ -1,6 +1,7 @@
 #ifndef PRECONDITIONERS_HPP
 #define PRECONDITIONERS_HPP
 #include "IncludesFile.hpp"
+#include "SolverPipelined.hpp"
 using namespace dealii;
 
   // Identity preconditioner.
@@ -105,6 +106,627 @@ using namespace dealii;
   };
 
 
+  // Approximation of the Schur complement B * diag(d) * B^T for a given
+  // diagonal scaling d. The patterns of B and B^T do not change during the
+  // simulation, so the sparsity of the triple product is computed only by the
+  // first build; the later builds reuse it and only refill the values: the rows
+  // of a persistent copy of B^T are scaled by d and the product is computed
+  // into the already filled matrix.
+  class SchurComplementApproximation
+  {
+  public:
+    void
+    build(const TrilinosWrappers::SparseMatrix &B,
+          const TrilinosWrappers::SparseMatrix &B_T,
+          const TrilinosWrappers::MPI::Vector &d,
+          const TrilinosWrappers::SparseMatrix *C = nullptr)
+    {
+      if (!initialized)
+      {
+        // Symbolic and numeric product.
+        B.mmult(S, B_T, d);
+        scaled_B_T.copy_from(B_T);
+
+        // S + C, with the union of the two patterns, so that C can be added
+        // in place at the following refills.
+        if (C)
+        {
+          Epetra_CrsMatrix *sum = nullptr;
+          const int ierr = EpetraExt::MatrixMatrix::Add(
+              S.trilinos_matrix(), false, 1., C->trilinos_matrix(), false, 1., sum);
+          AssertThrow(ierr == 0, ExcTrilinosError(ierr));
+          sum->FillComplete(S.trilinos_matrix().DomainMap(), S.trilinos_matrix().RangeMap());
+          S.reinit(*sum);
+          delete sum;
+        }
+        initialized = true;
+        return;
+      }
+
+      // Numeric refill: scaled_B_T = diag(d) * B^T, on the local rows. The
+      // rows of B^T and the entries of d share the same parallel layout.
+      const Epetra_CrsMatrix &B_T_epetra = B_T.trilinos_matrix();
+      Epetra_CrsMatrix &scaled_epetra =
+          const_cast<Epetra_CrsMatrix &>(scaled_B_T.trilinos_matrix());
+      const double *d_values = d.trilinos_vector()[0];
+
+      for (int row = 0; row < B_T_epetra.NumMyRows(); ++row)
+      {
+        int n_entries, n_scaled_entries;
+        double *values, *scaled_values;
+        int *indices, *scaled_indices;
+        B_T_epetra.ExtractMyRowView(row, n_entries, values, indices);
+        scaled_epetra.ExtractMyRowView(row, n_scaled_entries, scaled_values, scaled_indices);
+        AssertDimension(n_entries, n_scaled_entries);
+
+        for (int k = 0; k < n_entries; ++k)
+          scaled_values[k] = d_values[row] * values[k];
+      }
+
+      S = 0.0;
+      const int ierr = EpetraExt::MatrixMatrix::Multiply(
+          B.trilinos_matrix(), false, scaled_B_T.trilinos_matrix(), false,
+          const_cast<Epetra_CrsMatrix &>(S.trilinos_matrix()), false);
+      AssertThrow(ierr == 0, ExcTrilinosError(ierr));
+
+      if (C)
+        add_in_place(*C);
+    }
+
+    // Forget the sparsity (to be called if the patterns of B, B^T change).
+    void
+    clear()
+    {
+      initialized = false;
+    }
+
+    const TrilinosWrappers::SparseMatrix &
+    matrix() const
+    {
+      return S;
+    }
+
+  protected:
+    // S += C, the pattern of S containing the one of C (same rows).
+    void
+    add_in_place(const TrilinosWrappers::SparseMatrix &C)
+    {
+      const Epetra_CrsMatrix &C_epetra = C.trilinos_matrix();
+      Epetra_CrsMatrix &S_epetra = const_cast<Epetra_CrsMatrix &>(S.trilinos_matrix());
+      std::vector<int> global_columns;
+
+      for (int row = 0; row < C_epetra.NumMyRows(); ++row)
+      {
+        int n_entries;
+        double *values;
+        int *indices;
+        C_epetra.ExtractMyRowView(row, n_entries, values, indices);
+
+        global_columns.resize(n_entries);
+        for (int k = 0; k < n_entries; ++k)
+          global_columns[k] = C_epetra.GCID(indices[k]);
+
+        const int ierr = S_epetra.SumIntoGlobalValues(C_epetra.GRID(row), n_entries,
+                                                      values, global_columns.data());
+        AssertThrow(ierr == 0, ExcTrilinosError(ierr));
+      }
+    }
+
+    bool initialized = false;
+
+    // B * diag(d) * B^T (+ C).
+    TrilinosWrappers::SparseMatrix S;
+
+    // diag(d) * B^T, with the pattern of B^T.
+    TrilinosWrappers::SparseMatrix scaled_B_T;
+  };
+
+
+  // Layout of the velocity components in the velocity block, for the
+  // component-wise preconditioning of F. The nodes of the first component are
+  // numbered compactly from 0, each process owning a contiguous range of
+  // them: the k-th locally owned node is the scalar DoF
+  // scalar_owned_dofs.nth_index_in_set(k). The DoFs of the other components
+  // at the same node are owned by the same process.
+  struct VelocityComponents
+  {
+    // Locally owned scalar DoFs.
+    IndexSet scalar_owned_dofs;
+
+    // Scalar DoF of each locally relevant DoF of the first component, from
+    // its global index in the velocity block (the column of F).
+    std::map<types::global_dof_index, types::global_dof_index> scalar_columns;
+
+    // Local row in the velocity block of component d of the k-th scalar DoF,
+    // stored as rows[d][k].
+    std::vector<std::vector<unsigned int>> rows;
+
+    MPI_Comm mpi_communicator = MPI_COMM_WORLD;
+  };
+
+
+  // Preconditioner of the inner F and Schur solves. In double precision it is
+  // the Trilinos ILU. In single precision, the locally owned diagonal block of
+  // the matrix is copied in float and factorized with SparseILU<float> (block
+  // Jacobi across the processes, as the Trilinos ILU without overlap). The
+  // Krylov vectors of the inner solves stay in double: only the factors and
+  // the triangular solves, which dominate their memory traffic, are in float.
+  //
+  // For the velocity block F, the preconditioner can also be block diagonal
+  // over the velocity components: without the grad-div term, the scalar
+  // operator M/dt + nu L + C(u) is the same for every component, so only the
+  // block of the first component is extracted and factorized, and the
+  // factorization is applied to each component in turn. The grad-div term
+  // gamma d_x d_x, d_y d_y, d_z d_z differs from one component to the other,
+  // so the two are not combined. With Newton, the couplings between the
+  // components are neglected and the reaction term (d_d u_d) of the first
+  // component is used for all of them.
+  class PreconditionInner
+  {
+  public:
+    void
+    set_single_precision(const bool &single_precision_)
+    {
+      single_precision = single_precision_;
+    }
+
+    // Precondition component-wise with the given layout of the velocity
+    // components (null to factorize the whole matrix).
+    void
+    set_velocity_components(const VelocityComponents *components_)
+    {
+      if (components != components_)
+        clear();
+      components = components_;
+    }
+
+    // Forget the local pattern (to be called if the pattern of the matrix
+    // changes).
+    void
+    clear()
+    {
+      local_sparsity.reinit(0, 0, 0);
+      scalar_matrix.clear();
+      scalar_entry_columns.clear();
+    }
+
+    void
+    initialize(const TrilinosWrappers::SparseMatrix &full_matrix)
+    {
+      const TrilinosWrappers::SparseMatrix &matrix =
+          components ? extract_first_component(full_matrix) : full_matrix;
+
+      if (!single_precision)
+      {
+        preconditioner.initialize(matrix);
+        return;
+      }
+
+      const Epetra_CrsMatrix &A = matrix.trilinos_matrix();
+      const unsigned int n_rows = A.NumMyRows();
+
+      // The pattern of the local block is built by the first call only, the
+      // patterns of F and S_tilde do not change during the simulation.
+      if (local_sparsity.n_rows() != n_rows)
+      {
+        DynamicSparsityPattern dsp(n_rows);
+        for (unsigned int row = 0; row < n_rows; ++row)
+        {
+          int n_entries;
+          double *values;
+          int *indices;
+          A.ExtractMyRowView(row, n_entries, values, indices);
+          for (int k = 0; k < n_entries; ++k)
+          {
+            const int local_column = A.LRID(A.GCID(indices[k]));
+            if (local_column >= 0)
+              dsp.add(row, local_column);
+          }
+        }
+        local_sparsity.copy_from(dsp);
+        local_matrix.reinit(local_sparsity);
+        src_local.reinit(n_rows);
+        dst_local.reinit(n_rows);
+      }
+
+      local_matrix = 0;
+      for (unsigned int row = 0; row < n_rows; ++row)
+      {
+        int n_entries;
+        double *values;
+        int *indices;
+        A.ExtractMyRowView(row, n_entries, values, indices);
+        for (int k = 0; k < n_entries; ++k)
+        {
+          const int local_column = A.LRID(A.GCID(indices[k]));
+          if (local_column >= 0)
+            local_matrix.set(row, local_column, static_cast<float>(values[k]));
+        }
+      }
+
+      ilu.initialize(local_matrix);
+    }
+
+    void
+    vmult(TrilinosWrappers::MPI::Vector &dst,
+          const TrilinosWrappers::MPI::Vector &src) const
+    {
+      if (!components)
+      {
+        apply(dst, src);
+        return;
+      }
+
+      // Same scalar factorization for each component.
+      const double *src_values = src.trilinos_vector()[0];
+      double *dst_values = dst.trilinos_vector()[0];
+      double *scalar_src_values = scalar_src.trilinos_vector()[0];
+      const double *scalar_dst_values = scalar_dst.trilinos_vector()[0];
+
+      for (const std::vector<unsigned int> &rows : components->rows)
+      {
+        for (unsigned int k = 0; k < rows.size(); ++k)
+          scalar_src_values[k] = src_values[rows[k]];
+
+        apply(scalar_dst, scalar_src);
+
+        for (unsigned int k = 0; k < rows.size(); ++k)
+          dst_values[rows[k]] = scalar_dst_values[k];
+      }
+    }
+
+  protected:
+    // Block of the first velocity component, on the scalar numbering. Its
+    // pattern, and the scalar column of each entry of the rows of F, are
+    // built by the first call, the next ones only copy the values.
+    const TrilinosWrappers::SparseMatrix &
+    extract_first_component(const TrilinosWrappers::SparseMatrix &matrix)
+    {
+      const Epetra_CrsMatrix &A = matrix.trilinos_matrix();
+      const std::vector<unsigned int> &rows = components->rows[0];
+      const IndexSet &scalar_owned = components->scalar_owned_dofs;
+
+      if (scalar_matrix.m() == 0)
+      {
+        TrilinosWrappers::SparsityPattern sparsity(scalar_owned, components->mpi_communicator);
+        scalar_entry_columns.clear();
+        for (unsigned int k = 0; k < rows.size(); ++k)
+        {
+          int n_entries;
+          double *values;
+          int *indices;
+          A.ExtractMyRowView(rows[k], n_entries, values, indices);
+          for (int e = 0; e < n_entries; ++e)
+          {
+            const auto column = components->scalar_columns.find(A.GCID(indices[e]));
+            if (column == components->scalar_columns.end())
+              scalar_entry_columns.push_back(numbers::invalid_dof_index);
+            else
+            {
+              scalar_entry_columns.push_back(column->second);
+              sparsity.add(scalar_owned.nth_index_in_set(k), column->second);
+            }
+          }
+        }
+        sparsity.compress();
+        scalar_matrix.reinit(sparsity);
+        scalar_src.reinit(scalar_owned, components->mpi_communicator);
+        scalar_dst.reinit(scalar_owned, components->mpi_communicator);
+      }
+
+      unsigned int entry = 0;
+      for (unsigned int k = 0; k < rows.size(); ++k)
+      {
+        int n_entries;
+        double *values;
+        int *indices;
+        A.ExtractMyRowView(rows[k], n_entries, values, indices);
+        for (int e = 0; e < n_entries; ++e, ++entry)
+          if (scalar_entry_columns[entry] != numbers::invalid_dof_index)
+            scalar_matrix.set(scalar_owned.nth_index_in_set(k), scalar_entry_columns[entry], values[e]);
+      }
+      AssertDimension(entry, scalar_entry_columns.size());
+      scalar_matrix.compress(VectorOperation::insert);
+
+      return scalar_matrix;
+    }
+
+    void
+    apply(TrilinosWrappers::MPI::Vector &dst,
+          const TrilinosWrappers::MPI::Vector &src) const
+    {
+      if (!single_precision)
+      {
+        preconditioner.vmult(dst, src);
+        return;
+      }
+
+      // The local entries of the vectors follow the local rows of the matrix.
+      const double *src_values = src.trilinos_vector()[0];
+      double *dst_values = dst.trilinos_vector()[0];
+
+      for (unsigned int i = 0; i < src_local.size(); ++i)
+        src_local[i] = static_cast<float>(src_values[i]);
+
+      ilu.vmult(dst_local, src_local);
+
+      for (unsigned int i = 0; i < dst_local.size(); ++i)
+        dst_values[i] = dst_local[i];
+    }
+
+    bool single_precision = false;
+
+    // Component-wise preconditioning: layout, block of the first component
+    // (with the scalar column of each entry of its rows in F, invalid for the
+    // other components) and scalar vectors of the component solves.
+    const VelocityComponents *components = nullptr;
+    TrilinosWrappers::SparseMatrix scalar_matrix;
+    std::vector<types::global_dof_index> scalar_entry_columns;
+    mutable TrilinosWrappers::MPI::Vector scalar_src;
+    mutable TrilinosWrappers::MPI::Vector scalar_dst;
+
+    // Double precision path.
+    TrilinosWrappers::PreconditionILU preconditioner;
+
+    // Single precision path: local block, its factorization and the float
+    // copies of the vectors.
+    SparsityPattern local_sparsity;
+    SparseMatrix<float> local_matrix;
+    SparseILU<float> ilu;
+    mutable Vector<float> src_local;
+    mutable Vector<float> dst_local;
+  };
+
+
+  // Inner solves of the block preconditioners, with the deal.II GMRES and CG
+  // or with their pipelined variants (SolverPipelined.hpp), whose reductions
+  // overlap the products with the matrix and the preconditioner.
+  template <typename PreconditionerType>
+  void
+  inner_solve_gmres(SolverControl &solver_control,
+                    const bool &low_synchronization,
+                    const TrilinosWrappers::SparseMatrix &A,
+                    TrilinosWrappers::MPI::Vector &x,
+                    const TrilinosWrappers::MPI::Vector &b,
+                    const PreconditionerType &preconditioner)
+  {
+    if (low_synchronization)
+    {
+      SolverPipelinedGMRES<TrilinosWrappers::MPI::Vector> solver(solver_control);
+      solver.solve(A, x, b, preconditioner);
+    }
+    else
+    {
+      SolverGMRES<TrilinosWrappers::MPI::Vector> solver(solver_control);
+      solver.solve(A, x, b, preconditioner);
+    }
+  }
+
+  template <typename PreconditionerType>
+  void
+  inner_solve_cg(SolverControl &solver_control,
+                 const bool &low_synchronization,
+                 const TrilinosWrappers::SparseMatrix &A,
+                 TrilinosWrappers::MPI::Vector &x,
+                 const TrilinosWrappers::MPI::Vector &b,
+                 const PreconditionerType &preconditioner)
+  {
+    if (low_synchronization)
+    {
+      SolverPipelinedCG<TrilinosWrappers::MPI::Vector> solver(solver_control);
+      solver.solve(A, x, b, preconditioner);
+    }
+    else
+    {
+      SolverCG<TrilinosWrappers::MPI::Vector> solver(solver_control);
+      solver.solve(A, x, b, preconditioner);
+    }
+  }
+
+  // Solve with a Schur complement approximation: CG, unless it is not
+  // symmetric (stabilized systems, whose B is not the transpose of B^T).
+  template <typename PreconditionerType>
+  void
+  inner_solve_schur(SolverControl &solver_control,
+                    const bool &low_synchronization,
+                    const bool &symmetric,
+                    const TrilinosWrappers::SparseMatrix &A,
+                    TrilinosWrappers::MPI::Vector &x,
+                    const TrilinosWrappers::MPI::Vector &b,
+                    const PreconditionerType &preconditioner)
+  {
+    if (symmetric)
+      inner_solve_cg(solver_control, low_synchronization, A, x, b, preconditioner);
+    else
+      inner_solve_gmres(solver_control, low_synchronization, A, x, b, preconditioner);
+  }
+
+
+  // Diagonal data of the operators, shared by the block preconditioners.
+  //
+  // The velocity mass matrix (M / deltat) does not change: the inverse of its
+  // diagonal and of its lumped version are computed once. The diagonal of F
+  // changes with the convection (and with the Dirichlet rows and the Newton
+  // terms), so it is extracted from F once per linear solve, with a single
+  // pass on the Epetra rows, together with its inverse.
+  class OperatorDiagonals
+  {
+  public:
+    void
+    initialize_mass(const TrilinosWrappers::SparseMatrix &M)
+    {
+      reinit(neg_diag_M_inv, M);
+      reinit(diag_M_inv, M);
+      reinit(neg_lumped_M_inv, M);
+
+      const Epetra_CrsMatrix &M_epetra = M.trilinos_matrix();
+      Epetra_Vector diag_M_view(View, diag_M_inv.trilinos_vector(), 0);
+      const int ierr = M_epetra.ExtractDiagonalCopy(diag_M_view);
+      AssertThrow(ierr == 0, ExcTrilinosError(ierr));
+      diag_M_view.Reciprocal(diag_M_view);
+      neg_diag_M_inv.trilinos_vector().Scale(-1.0, diag_M_view);
+
+      // Lumped mass: sum of the absolute values of each row.
+      double *lumped_values = neg_lumped_M_inv.trilinos_vector()[0];
+      for (int row = 0; row < M_epetra.NumMyRows(); ++row)
+      {
+        int n_entries;
+        double *values;
+        int *indices;
+        M_epetra.ExtractMyRowView(row, n_entries, values, indices);
+
+        double sum = 0.0;
+        for (int k = 0; k < n_entries; ++k)
+          sum += std::abs(values[k]);
+        lumped_values[row] = -1.0 / sum;
+      }
+    }
+
+    // The vectors of diag(F) keep their layout until clear() is called (when
+    // the mesh changes, the rows can be repartitioned with the same size).
+    void
+    update_F(const TrilinosWrappers::SparseMatrix &F)
+    {
+      if (diag_F.size() != F.m())
+      {
+        reinit(diag_F, F);
+        reinit(diag_F_inv, F);
+        reinit(neg_diag_F_inv, F);
+      }
+
+      Epetra_Vector diag_F_view(View, diag_F.trilinos_vector(), 0);
+      const int ierr = F.trilinos_matrix().ExtractDiagonalCopy(diag_F_view);
+      AssertThrow(ierr == 0, ExcTrilinosError(ierr));
+      diag_F_inv.trilinos_vector().Reciprocal(diag_F_view);
+      neg_diag_F_inv.trilinos_vector().Scale(-1.0, diag_F_inv.trilinos_vector());
+    }
+
+    // Release the diagonals, to be updated on a new layout of the rows.
+    void
+    clear()
+    {
+      diag_F.clear();
+      diag_F_inv.clear();
+      neg_diag_F_inv.clear();
+      diag_M_inv.clear();
+      neg_diag_M_inv.clear();
+      neg_lumped_M_inv.clear();
+    }
+
+    // diag(F), diag(F)^-1 and -diag(F)^-1.
+    const TrilinosWrappers::MPI::Vector &
+    get_diag_F() const
+    {
+      return diag_F;
+    }
+    const TrilinosWrappers::MPI::Vector &
+    get_diag_F_inv() const
+    {
+      return diag_F_inv;
+    }
+    const TrilinosWrappers::MPI::Vector &
+    get_neg_diag_F_inv() const
+    {
+      return neg_diag_F_inv;
+    }
+
+    // diag(M)^-1, -diag(M)^-1 and -lumped(M)^-1.
+    const TrilinosWrappers::MPI::Vector &
+    get_diag_M_inv() const
+    {
+      return diag_M_inv;
+    }
+    const TrilinosWrappers::MPI::Vector &
+    get_neg_diag_M_inv() const
+    {
+      return neg_diag_M_inv;
+    }
+    const TrilinosWrappers::MPI::Vector &
+    get_neg_lumped_M_inv() const
+    {
+      return neg_lumped_M_inv;
+    }
+
+  protected:
+    // Vector with the layout of the rows of the matrix.
+    static void
+    reinit(TrilinosWrappers::MPI::Vector &v, const TrilinosWrappers::SparseMatrix &matrix)
+    {
+      v.reinit(matrix.locally_owned_range_indices(), matrix.get_mpi_communicator());
+    }
+
+    TrilinosWrappers::MPI::Vector diag_F;
+    TrilinosWrappers::MPI::Vector diag_F_inv;
+    TrilinosWrappers::MPI::Vector neg_diag_F_inv;
+
+    TrilinosWrappers::MPI::Vector diag_M_inv;
+    TrilinosWrappers::MPI::Vector neg_diag_M_inv;
+    TrilinosWrappers::MPI::Vector neg_lumped_M_inv;
+  };
+
+
+  // Settings and inner preconditioners (of F and of the Schur complement
+  // approximation) shared by the block preconditioners, so that they are all
+  // configured by the same calls.
+  class BlockPreconditionerBase
+  {
+  public:
+    // Set the relative tolerance of the inner solves.
+    void
+    set_tolerance(const double &tol_)
+    {
+      tol = tol_;
+    }
+
+    // Run the inner solves with the single precision preconditioners.
+    void
+    set_single_precision(const bool &single_precision)
+    {
+      preconditioner_F.set_single_precision(single_precision);
+      preconditioner_S.set_single_precision(single_precision);
+    }
+
+    // Precondition F component-wise (see PreconditionInner).
+    void
+    set_velocity_components(const VelocityComponents *components)
+    {
+      preconditioner_F.set_velocity_components(components);
+    }
+
+    // Use the low synchronization inner solvers (SolverPipelined.hpp).
+    void
+    set_low_synchronization(const bool &low_synchronization_)
+    {
+      low_synchronization = low_synchronization_;
+    }
+
+    // Pressure-pressure block C of a stabilized system, added to the Schur
+    // complement approximation (null if the block is zero).
+    void
+    set_pressure_stabilization(const TrilinosWrappers::SparseMatrix *C_)
+    {
+      C = C_;
+    }
+
+    // Forget the patterns of the inner preconditioners (to be called when the
+    // mesh changes).
+    void
+    clear()
+    {
+      preconditioner_F.clear();
+      preconditioner_S.clear();
+    }
+
+  protected:
+    // Relative tolerance of the inner solves.
+    double tol = 1e-2;
+    bool low_synchronization = false;
+    const TrilinosWrappers::SparseMatrix *C = nullptr;
+    PreconditionInner preconditioner_F;
+    PreconditionInner preconditioner_S;
+  };
+
+
 // Apply the SIMPLE preconditioner.
     //
     // The application of the P_SIMPLE can be divided into two steps:
@@ -115,37 +737,35 @@ using namespace dealii;
     //      [ I    D^-1*B^T ] [ dst_u ] = [ sol1_u ]
     //      [ 0      alpha  ] [ dst_p ]   [ sol1_p ]
     //
-  class PreconditionSIMPLE 
+  class PreconditionSIMPLE : public BlockPreconditionerBase
   {
   public:
     void
     initialize(const TrilinosWrappers::SparseMatrix &F_,
                const TrilinosWrappers::SparseMatrix &B_,
                const TrilinosWrappers::SparseMatrix &B_t,
+               const OperatorDiagonals &diagonals_,
                const TrilinosWrappers::MPI::BlockVector &sol_owned
                )
     {
       F = &F_;
       B = &B_; 
       B_T = &B_t;
-    
-      neg_diag_D_inv.reinit(sol_owned.block(0));
-      diag_D_inv.reinit(sol_owned.block(0));
+      diagonals = &diagonals_;
 
-      for (unsigned int i : diag_D_inv.locally_owned_elements())
-      {
-        double temp = F->diag_element(i);
-        diag_D_inv[i] = 1.0 / temp;
-        neg_diag_D_inv[i] = - 1.0 / temp;     
-      }
+      // Workspace of vmult, sized once here
+      sol1_u.reinit(sol_owned.block(0));
+      sol1_p.reinit(sol_owned.block(1));
+      temp_1.reinit(sol_owned.block(1));
+      tmp.reinit(sol_owned.block(0));
 
-      // Create S_tilde =B * (D^-1) * B^T,
+      // Create S_tilde =B * (D^-1) * B^T, D = diag(F)
       // note: Using negative (D^-1) to create - S_tilde 
-      B->mmult(negative_S_tilde, *B_T, neg_diag_D_inv); 
+      negative_S_tilde.build(*B, *B_T, diagonals->get_neg_diag_F_inv(), C); 
 
       // Initialize the preconditioners
       preconditioner_F.initialize(*F);
-      preconditioner_S.initialize(negative_S_tilde);
+      preconditioner_S.initialize(negative_S_tilde.matrix());
       
     }
     void
@@ -153,33 +773,28 @@ using namespace dealii;
           const TrilinosWrappers::MPI::BlockVector &src) const 
     {
       const unsigned int maxiter = 10000;
-      const double tol = 1e-2;
       SolverControl solver_F(maxiter, tol * src.block(0).l2_norm());
 
-      SolverGMRES<TrilinosWrappers::MPI::Vector> solver_gmres(solver_F);
-
       // 1. Solve the block lower triangular system:
     //      [ F    0 ]      [ sol1_u ] =       [ src_u ]
     //      [ B   -S_tilde ] [ sol1_p ]   [ src_p ]
 
       //Step 1.1 Solve Fsol1_u = src_u
 
-      // Store in temporaries the results
-      TrilinosWrappers::MPI::Vector sol1_u = src.block(0);  
-      TrilinosWrappers::MPI::Vector sol1_p = src.block(1);
-      
-      TrilinosWrappers::MPI::Vector temp_1 = src.block(1);
+      // Store in temporaries the results (the workspace has already the
+      // right layout, so these are plain copies)
+      sol1_u = src.block(0);
+      sol1_p = src.block(1);
 
-      solver_gmres.solve(*F, sol1_u, src.block(0), preconditioner_F);
+      inner_solve_gmres(solver_F, low_synchronization, *F, sol1_u, src.block(0), preconditioner_F);
 
       B->vmult(temp_1, sol1_u); //temp_1 = B * sol1_u
       temp_1 -= src.block(1); //temp1 = src_p - B * sol1_u
 
       //Step 1.2 Solve -S_tilde * sol1_p = src_p - temp1 (RHS)
       SolverControl solver_S(maxiter, tol * temp_1.l2_norm());
-      SolverCG<TrilinosWrappers::MPI::Vector> solver_cg(solver_S);
       //Note we have already constructed S-tilde as - S_tilde 
-      solver_cg.solve(negative_S_tilde, sol1_p, temp_1, preconditioner_S);
+      inner_solve_schur(solver_S, low_synchronization, C == nullptr, negative_S_tilde.matrix(), sol1_p, temp_1, preconditioner_S);
 
       // temp_1.reinit(dst.block(0));
 
@@ -197,58 +812,62 @@ using namespace dealii;
         //2.2 dst(0) = sol1_u - inv(D)B.T dst(1)
 
         dst.block(0) = sol1_u; // Start with sol1_u.
-        TrilinosWrappers::MPI::Vector tmp = src.block(0); //to have same dim as sol1_u
         B_T->vmult(tmp, dst.block(1)); ////tmp = BT*dst.block(1)
-        tmp.scale(diag_D_inv); //tmp = inv(D)*tmp
+        tmp.scale(diagonals->get_diag_F_inv()); //tmp = inv(D)*tmp
         dst.block(0) -= tmp; //sol1_u - tmp
         
     }
+
+    // Forget the patterns of the Schur complement approximation and of the
+    // inner preconditioners (to be called when the mesh changes).
+    void
+    clear()
+    {
+      negative_S_tilde.clear();
+      BlockPreconditionerBase::clear();
+    }
+
   protected:
     const double alpha = 0.5; // parameter (0,1]
 
     const TrilinosWrappers::SparseMatrix *F;
     const TrilinosWrappers::SparseMatrix *B_T;
     const TrilinosWrappers::SparseMatrix *B;
-    TrilinosWrappers::SparseMatrix negative_S_tilde;
-    TrilinosWrappers::MPI::Vector diag_D_inv;
-    TrilinosWrappers::MPI::Vector neg_diag_D_inv;
-    TrilinosWrappers::PreconditionILU preconditioner_F;
-    TrilinosWrappers::PreconditionILU preconditioner_S;
+    const OperatorDiagonals *diagonals;
+    SchurComplementApproximation negative_S_tilde;
+
+    // Workspace of vmult.
+    mutable TrilinosWrappers::MPI::Vector sol1_u;
+    mutable TrilinosWrappers::MPI::Vector sol1_p;
+    mutable TrilinosWrappers::MPI::Vector temp_1;
+    mutable TrilinosWrappers::MPI::Vector tmp;
   };
 //Simple Correct
 //Approximate version
-  class PreconditionaSIMPLE 
+  class PreconditionaSIMPLE : public BlockPreconditionerBase
   {
   public:
     void
     initialize(const TrilinosWrappers::SparseMatrix &F_,
                const TrilinosWrappers::SparseMatrix &B_,
                const TrilinosWrappers::SparseMatrix &B_t,
+               const OperatorDiagonals &diagonals_,
                const TrilinosWrappers::MPI::BlockVector &sol_owned
                )
     {
       F = &F_;
       B = &B_;
       B_T = &B_t;
-     
-
-      diag_D_inv.reinit(sol_owned.block(0));
-      diag_D.reinit(sol_owned.block(0));
-      neg_diag_D_inv.reinit(sol_owned.block(0));
+      diagonals = &diagonals_;
 
-      for (unsigned int i : diag_D.locally_owned_elements())
-      {
-        double temp = F->diag_element(i);
-        diag_D[i] = temp;
-        diag_D_inv[i] = 1.0 / temp;
-        neg_diag_D_inv[i] = - 1.0 / temp;
-      }
+      // Workspace of vmult, sized once here
+      tmp.reinit(sol_owned);
 
-      //S_tilde = BD(^-1)B.T
-      B->mmult(neg_S, *B_T, neg_diag_D_inv); //Note: we need -S_tilde, so we use - D(^-1)
+      //S_tilde = BD(^-1)B.T, D = diag(F)
+      neg_S.build(*B, *B_T, diagonals->get_neg_diag_F_inv(), C); //Note: we need -S_tilde, so we use - D(^-1)
 
       preconditioner_F.initialize(*F);
-      preconditioner_S.initialize(neg_S); //already assembled neg_S
+      preconditioner_S.initialize(neg_S.matrix()); //already assembled neg_S
     }
 
     void
@@ -257,20 +876,17 @@ using namespace dealii;
     {
 
       const unsigned int maxit = 10000;
-      const double tol = 1e-2;
 
       //devo definire due tmp non posso fare block 
 
 
-       // Prepare 2 temporary vectors to hold intermediate data.
-        tmp.reinit(src); 
+       // The temporary vectors tmp.block(0), tmp.block(1) are sized in initialize.
 
         // --- Step 1 ---
         // Solve for the primary (first block) variable.
         // This computes an approximate inverse of C applied to the first part of src.
         SolverControl solver_control_F(maxit, tol * src.block(0).l2_norm());
-        SolverGMRES<TrilinosWrappers::MPI::Vector> solver_F(solver_control_F);
-        solver_F.solve(*F, dst.block(0), src.block(0), preconditioner_F);
+        inner_solve_gmres(solver_control_F, low_synchronization, *F, dst.block(0), src.block(0), preconditioner_F);
 
         // --- Step 2 ---
         // Copy the secondary part of src into a temporary container.
@@ -285,13 +901,12 @@ using namespace dealii;
         // Solve the system with the approximate Schur complement.
         // This computes the secondary variable by inverting negS_matrix.
         SolverControl solver_control_S(maxit, tol * tmp.block(1).l2_norm());
-        SolverGMRES<TrilinosWrappers::MPI::Vector> solver_S(solver_control_S);
-        solver_S.solve(neg_S, dst.block(1), tmp.block(1), preconditioner_S);
+        inner_solve_schur(solver_control_S, low_synchronization, C == nullptr, neg_S.matrix(), dst.block(1), tmp.block(1), preconditioner_S);
 
         // --- Step 4 ---
         // Scale the primary component by the original diagonal entries.
         // This reintroduces the proper weighting based on C's diagonal.
-        dst.block(0).scale(diag_D);
+        dst.block(0).scale(diagonals->get_diag_F());
 
         // --- Step 5 ---
         // Adjust the secondary component by applying the damping factor.
@@ -306,88 +921,85 @@ using namespace dealii;
         
         // --- Step 7 ---
         // Finalize the update of the primary component by scaling it with Dinv.
-        dst.block(0).scale(diag_D_inv);
+        dst.block(0).scale(diagonals->get_diag_F_inv());
       
     }
 
+    // Forget the patterns of the Schur complement approximation and of the
+    // inner preconditioners (to be called when the mesh changes).
+    void
+    clear()
+    {
+      neg_S.clear();
+      BlockPreconditionerBase::clear();
+    }
+
   protected:
     const TrilinosWrappers::SparseMatrix *F;
     const TrilinosWrappers::SparseMatrix *B_T;
     const TrilinosWrappers::SparseMatrix *B;
-    TrilinosWrappers::SparseMatrix neg_S;
-
-    TrilinosWrappers::PreconditionILU preconditioner_F;
-    TrilinosWrappers::PreconditionILU preconditioner_S;
-    
+    const OperatorDiagonals *diagonals;
+    SchurComplementApproximation neg_S;
 
-    TrilinosWrappers::MPI::Vector diag_D;
-    TrilinosWrappers::MPI::Vector diag_D_inv;
-    TrilinosWrappers::MPI::Vector neg_diag_D_inv;
     mutable TrilinosWrappers::MPI::BlockVector tmp;
    
     const double alpha = 1.;
   };
 // approximate Simple Correct
   // Yosida preconditioner -- the inverse of Mu is replaced by the inverse of it's diagonal's elements
-  class PreconditionYosida 
+  class PreconditionYosida : public BlockPreconditionerBase
   {
   public:
     void
     initialize(const TrilinosWrappers::SparseMatrix &F_,
                const TrilinosWrappers::SparseMatrix &B_,
                const TrilinosWrappers::SparseMatrix &B_t,
-               const TrilinosWrappers::SparseMatrix &M_,
+               const OperatorDiagonals &diagonals_,
                const TrilinosWrappers::MPI::BlockVector &sol_owned)
     {
       F = &F_;
       B = &B_;
       B_T = &B_t;
-      M = &M_;
-      
-      diag_D_inv.reinit(sol_owned.block(0));
-      neg_diag_D_inv.reinit(sol_owned.block(0));
-
-      for (unsigned int i : diag_D_inv.locally_owned_elements())
-      {
-        //Note : we have assembled M as M/deltat
-        diag_D_inv[i] = ( 1.0 / M->diag_element(i));  //  dt * (Mii)^-1
-        neg_diag_D_inv[i] = ( -1.0 / M->diag_element(i));  //  dt * (Mii)^-1
-      }
-
-      // Create negative_S_tilde
-      B->mmult(negative_S_tilde, *B_T, neg_diag_D_inv);
+      diagonals = &diagonals_;
+
+      // Workspace of vmult, sized once here
+      yu.reinit(sol_owned.block(0));
+      yp.reinit(sol_owned.block(1));
+      tmp.reinit(sol_owned.block(1));
+      tmp2.reinit(sol_owned.block(0));
+      res.reinit(sol_owned.block(0));
+
+      // Create negative_S_tilde with - dt * (Mii)^-1
+      //Note : we have assembled M as M/deltat
+      negative_S_tilde.build(*B, *B_T, diagonals->get_neg_diag_M_inv(), C);
     
       // Initialize the preconditioners
       preconditioner_F.initialize(*F);
-      preconditioner_S.initialize(negative_S_tilde);
+      preconditioner_S.initialize(negative_S_tilde.matrix());
     }
     void
     vmult(TrilinosWrappers::MPI::BlockVector &dst,
           const TrilinosWrappers::MPI::BlockVector &src) const 
     {
       const unsigned int maxiter = 100000;
-      const double tol = 1e-2;
 
       SolverControl solver_F(maxiter, tol * src.block(0).l2_norm());
-      SolverGMRES<TrilinosWrappers::MPI::Vector> solver_gmres(solver_F);
 
-      // Store in temporaries the results
-      TrilinosWrappers::MPI::Vector yu = src.block(0);
-      TrilinosWrappers::MPI::Vector yp = src.block(1);
-      TrilinosWrappers::MPI::Vector tmp = src.block(1);
-      TrilinosWrappers::MPI::Vector tmp2 = src.block(0);
+      // Store in temporaries the results (the workspace has already the
+      // right layout, so these are plain copies)
+      yu = src.block(0);
+      yp = src.block(1);
 
       //Step 1
       // Step 1.1) yu = F^-1 * src.0
-      solver_gmres.solve(*F, yu, src.block(0), preconditioner_F);
+      inner_solve_gmres(solver_F, low_synchronization, *F, yu, src.block(0), preconditioner_F);
       
       //Step 1.2) yp = negative_S_tilde^-1(src1-B*yu)
       B->vmult(tmp, yu); //tmp = B*yu
       tmp.add(-1.0, src.block(1)); // tmp = src.block(1) - tmp
       // neg_S*yp = (src(1) - Byu)==tmp(RHS)
       SolverControl solver_S(maxiter, tol * tmp.l2_norm());
-      SolverCG<TrilinosWrappers::MPI::Vector> solver_cg(solver_S);
-      solver_cg.solve(negative_S_tilde, yp, tmp, preconditioner_S);
+      inner_solve_schur(solver_S, low_synchronization, C == nullptr, negative_S_tilde.matrix(), yp, tmp, preconditioner_S);
 
       //Step 2) 
       // Step 2.1) dst1 = yp
@@ -398,98 +1010,86 @@ using namespace dealii;
       B_T->vmult(tmp2, dst.block(1)); //tmp2 = B_T*yp (rhs)
 
       //Solve the linear system 
-      res.reinit(src.block(0)); //to store the result of the  lin sys F res = tmp2
+      res = 0.0; //to store the result of the  lin sys F res = tmp2
       dst.block(0) = yu; //init final velocity dest 
       SolverControl solver_F2(maxiter, tol * tmp2.l2_norm());
-      SolverGMRES<TrilinosWrappers::MPI::Vector> solver_gmres2(solver_F2);
-      solver_gmres2.solve(*F, res, tmp2, preconditioner_F); // res = F^-1 * tmp2 
+      inner_solve_gmres(solver_F2, low_synchronization, *F, res, tmp2, preconditioner_F); // res = F^-1 * tmp2 
       dst.block(0).sadd(-1,res); //update final velocity dest dstu = yu - res
 
     }
 
-  protected:
+    // Forget the patterns of the Schur complement approximation and of the
+    // inner preconditioners (to be called when the mesh changes).
+    void
+    clear()
+    {
+      negative_S_tilde.clear();
+      BlockPreconditionerBase::clear();
+    }
 
+  protected:
     const TrilinosWrappers::SparseMatrix *F;
     const TrilinosWrappers::SparseMatrix *B_T;
     const TrilinosWrappers::SparseMatrix *B;
-    const TrilinosWrappers::SparseMatrix *M;
-    TrilinosWrappers::SparseMatrix negative_S_tilde;
-    TrilinosWrappers::MPI::Vector diag_D_inv;
-    TrilinosWrappers::MPI::Vector neg_diag_D_inv;
-    TrilinosWrappers::PreconditionILU preconditioner_F;
-    TrilinosWrappers::PreconditionILU preconditioner_S;
+    const OperatorDiagonals *diagonals;
+    SchurComplementApproximation negative_S_tilde;
 
+    // Workspace of vmult.
+    mutable TrilinosWrappers::MPI::Vector yu;
+    mutable TrilinosWrappers::MPI::Vector yp;
+    mutable TrilinosWrappers::MPI::Vector tmp;
+    mutable TrilinosWrappers::MPI::Vector tmp2;
     mutable TrilinosWrappers::MPI::Vector res;
   };
 
   // Precondition approximate Yosida: Why it so slow?
   
-  class PreconditionaYosida 
+  class PreconditionaYosida : public BlockPreconditionerBase
  {
   public:
     void
     initialize(const TrilinosWrappers::SparseMatrix &F_,
                const TrilinosWrappers::SparseMatrix &B_,
                const TrilinosWrappers::SparseMatrix &B_t,
-               const TrilinosWrappers::SparseMatrix &M_,
+               const OperatorDiagonals &diagonals_,
                const TrilinosWrappers::MPI::BlockVector &sol_owned)
     {
       F = &F_;
       B = &B_;
       B_T = &B_t;
-      M = &M_;
+      diagonals = &diagonals_;
 
-      diag_D_inv.reinit(sol_owned.block(0));
-      diag_D.reinit(sol_owned.block(0));
-      lump_M.reinit(sol_owned.block(0));
+      // Workspace of vmult, sized once here
+      tmp.reinit(sol_owned.block(0));
+      tmp2.reinit(sol_owned.block(1));
+      yu.reinit(sol_owned.block(0));
+      yp.reinit(sol_owned.block(1));
+      Fyu.reinit(sol_owned.block(0));
 
+      //Note: We use - deltat * (lump_M)^-1 to create negative S, the lumped
+      //mass is cached once in diagonals (we have assembled M/deltat)
+      negative_S.build(*B, *B_T, diagonals->get_neg_lumped_M_inv(), C); // neg_S
 
-      for (unsigned int i : diag_D.locally_owned_elements())
-      {
-        double temp = F->diag_element(i);
-        diag_D[i] = temp;
-        diag_D_inv[i] = 1.0 / temp; // (F_hat)^-1
-      }
-
-
-    // build lumped_M
-    for (unsigned int i : lump_M.locally_owned_elements())
-      {
-        //Note : we have assembled M/deltat
-        double temp = 0.0;
-        for (auto it = M->begin(i); it != M->end(i); ++it)
-            temp += std::abs(it->value());
-
-        
-        lump_M[i] = -1.0 / temp; // - deltat * (lump_M)^-1
-      }
-
-      //Note: We use -lump_M to create negative S
-      B->mmult(negative_S, *B_T, lump_M); // neg_S
-
-      preconditionerF.initialize(*F);
-      preconditionerS.initialize(negative_S);
+      preconditioner_F.initialize(*F);
+      preconditioner_S.initialize(negative_S.matrix());
     }
 
     void
     vmult(TrilinosWrappers::MPI::BlockVector &dst,
           const TrilinosWrappers::MPI::BlockVector &src) const 
     { 
-      //Note : diag_D_inv = (F_hat)^-1
-      tmp.reinit(src.block(0)); // block 0
-      tmp2.reinit(src.block(1)); //block 1 
+      //Note : (F_hat)^-1 = diag(F)^-1, from diagonals
+      // tmp (block 0), tmp2 (block 1), yu, yp are sized in initialize
 
       const unsigned int maxiter = 100000;
-      const double tol = 1e-2;
 
       // Store in temporaries the results of src updates 
-      TrilinosWrappers::MPI::Vector yu = src.block(0);
-      TrilinosWrappers::MPI::Vector yp = src.block(1);
+      yp = src.block(1);
 
       //Step 1) (F_hat)^-1 * src(0) = tmp
       
       tmp = src.block(0);
-      tmp.scale(diag_D_inv);
+      tmp.scale(diagonals->get_diag_F_inv());
       yu = tmp;      
 
       //Step 2)   
@@ -498,40 +1098,114 @@ using namespace dealii;
        
        //Step 3) true solution of neg_S to have better accuracy, instead of neg_S_hat
       SolverControl solver_S(maxiter, tol * yp.l2_norm());
-      SolverCG<TrilinosWrappers::MPI::Vector> solver_cg(solver_S);
-      solver_cg.solve(negative_S, dst.block(1), yp, preconditionerS); //dst.block(1) updated here 
+      inner_solve_schur(solver_S, low_synchronization, C == nullptr, negative_S.matrix(), dst.block(1), yp, preconditioner_S); //dst.block(1) updated here 
 
       yp = dst.block(1); //updating src(1) for next computations
 
-      //Step 4) 
-      F->vmult(yu,yu);
+      //Step 4) F*yu (stored apart, vmult cannot work in place)
+      F->vmult(Fyu, yu);
 
       //Step 5)
        B_T->vmult(tmp, yp); //tmp(0) = BT*src(1)
+       yu = Fyu;
        yu.sadd(-1.0,tmp);
 
       //Step 6) 
-      yu.scale(diag_D_inv);
+      yu.scale(diagonals->get_diag_F_inv());
       dst.block(0) = yu;
 
     }
 
+    // Forget the patterns of the Schur complement approximation and of the
+    // inner preconditioners (to be called when the mesh changes).
+    void
+    clear()
+    {
+      negative_S.clear();
+      BlockPreconditionerBase::clear();
+    }
+
   protected:
     const TrilinosWrappers::SparseMatrix *F;
     const TrilinosWrappers::SparseMatrix *B_T;
     const TrilinosWrappers::SparseMatrix *B;
-    const TrilinosWrappers::SparseMatrix *M;
-    TrilinosWrappers::SparseMatrix negative_S;
-
-    TrilinosWrappers::PreconditionILU preconditionerF;
-    TrilinosWrappers::PreconditionILU preconditionerS;
+    const OperatorDiagonals *diagonals;
+    SchurComplementApproximation negative_S;
 
-    TrilinosWrappers::MPI::Vector diag_D;
-    TrilinosWrappers::MPI::Vector lump_M;
-    TrilinosWrappers::MPI::Vector diag_D_inv;
+    // Workspace of vmult.
     mutable TrilinosWrappers::MPI::Vector tmp;
     mutable TrilinosWrappers::MPI::Vector tmp2;
+    mutable TrilinosWrappers::MPI::Vector yu;
+    mutable TrilinosWrappers::MPI::Vector yp;
+    mutable TrilinosWrappers::MPI::Vector Fyu;
   }; 
+
+  // Augmented Lagrangian preconditioner, for the system with the grad-div
+  // term gamma (div u, div v) in F. Block upper triangular:
+  //
+  //   [ F  B^T ]
+  //   [ 0  S   ],   S^-1 = (nu + gamma) Mp^-1.
+  //
+  // With the grad-div term the Schur complement is close to the pressure mass
+  // matrix scaled by 1 / (nu + gamma), whatever the convection and the mesh.
+  // This approximation does not include the pressure-pressure block of a
+  // stabilized system, which initialize() refuses.
+  class PreconditionAugmentedLagrangian : public BlockPreconditionerBase
+  {
+  public:
+    // The pressure mass matrix is passed with its scaling: S^-1 is
+    // schur_scaling * pressure_mass^-1.
+    void
+    initialize(const TrilinosWrappers::SparseMatrix &F_,
+               const TrilinosWrappers::SparseMatrix &B_t,
+               const TrilinosWrappers::SparseMatrix &pressure_mass_,
+               const double &schur_scaling_,
+               const TrilinosWrappers::MPI::BlockVector &sol_owned)
+    {
+      AssertThrow(C == nullptr,
+                  ExcMessage("The augmented Lagrangian preconditioner does not support the "
+                             "pressure stabilization."));
+      F = &F_;
+      B_T = &B_t;
+      pressure_mass = &pressure_mass_;
+      schur_scaling = schur_scaling_;
+
+      // Workspace of vmult, sized once here
+      tmp.reinit(sol_owned.block(0));
+
+      preconditioner_F.initialize(*F);
+      preconditioner_S.initialize(*pressure_mass);
+    }
+
+    void
+    vmult(TrilinosWrappers::MPI::BlockVector &dst,
+          const TrilinosWrappers::MPI::BlockVector &src) const
+    {
+      const unsigned int maxiter = 10000;
+
+      // 1. dst_p = S^-1 src_p, with the (symmetric) pressure mass matrix.
+      SolverControl solver_S(maxiter, tol * src.block(1).l2_norm());
+      dst.block(1) = 0.0;
+      inner_solve_cg(solver_S, low_synchronization, *pressure_mass, dst.block(1), src.block(1), preconditioner_S);
+      dst.block(1) *= schur_scaling;
+
+      // 2. F dst_u = src_u - B^T dst_p.
+      B_T->vmult(tmp, dst.block(1));
+      tmp.sadd(-1.0, src.block(0));
+      SolverControl solver_F(maxiter, tol * tmp.l2_norm());
+      dst.block(0) = 0.0;
+      inner_solve_gmres(solver_F, low_synchronization, *F, dst.block(0), tmp, preconditioner_F);
+    }
+
+  protected:
+    const TrilinosWrappers::SparseMatrix *F;
+    const TrilinosWrappers::SparseMatrix *B_T;
+    const TrilinosWrappers::SparseMatrix *pressure_mass;
+    double schur_scaling = 1.0;
+
+    // Workspace of vmult.
+    mutable TrilinosWrappers::MPI::Vector tmp;
+  };
   
   #endif
   
\ No newline at end of file
@@ -0,0 +1,190 @@
+#ifndef PROBLEM_DESCRIPTION_HPP
+#define PROBLEM_DESCRIPTION_HPP
+
+#include "IncludesFile.hpp"
+
+using namespace dealii;
+
+// Description of a Navier-Stokes problem: physical parameters, boundary and
+// initial data, and what to post-process. The solver NavierStokes<dim> only
+// talks to this interface, so that the same assembly/solve/output path serves
+// the flow past a cylinder (2D and 3D) and the convergence study.
+template <int dim>
+class ProblemDescription
+{
+public:
+  // Map from boundary id to the Dirichlet datum on that boundary.
+  using BoundaryFunctions = std::map<types::boundary_id, const Function<dim> *>;
+
+  // Pair of periodic boundaries and the direction in which they face each
+  // other.
+  using PeriodicBoundary = std::tuple<types::boundary_id, types::boundary_id, unsigned int>;
+
+  ProblemDescription()
+    : zero_function(dim + 1)
+  {
+  }
+
+  virtual ~ProblemDescription() = default;
+
+  // Name of the problem, used for output files.
+  virtual std::string
+  name() const = 0;
+
+  // Name of the problem with the parameters that change its solution (test
+  // case, data), used as key of the logs reused between runs.
+  virtual std::string
+  configuration() const
+  {
+    return name();
+  }
+
+  // Kinematic viscosity [m2/s].
+  virtual double
+  viscosity() const = 0;
+
+  // Density.
+  virtual double
+  density() const
+  {
+    return 1.0;
+  }
+
+  // Set the time of all the time dependent data.
+  virtual void
+  set_time(const double &time) = 0;
+
+  // Dirichlet data (on the velocity components), as groups imposed in order:
+  // a group overrides the previous ones on the DoFs they share.
+  virtual std::vector<BoundaryFunctions>
+  dirichlet_boundaries() const = 0;
+
+  // Dirichlet data separable in space and time, g(x, t) = c(t) g0(x): the
+  // spatial profiles g0 (same groups as dirichlet_boundaries()), interpolated
+  // once by the solver, and the factor c at the current time. An empty vector
+  // means that the data are not separable and are interpolated at each step.
+  virtual std::vector<BoundaryFunctions>
+  dirichlet_profiles() const
+  {
+    return {};
+  }
+
+  virtual double
+  dirichlet_time_factor() const
+  {
+    return 1.0;
+  }
+
+  // Hexahedral mesh of the domain, with the boundary ids of the simplex
+  // meshes, used with adaptive refinement (the simplex meshes cannot be
+  // refined locally). Not available by default.
+  virtual void
+  make_hex_mesh(Triangulation<dim> &mesh) const
+  {
+    (void)mesh;
+    AssertThrow(false, ExcMessage("No hexahedral mesh for the problem " + name()));
+  }
+
+  // Periodic boundaries, none by default.
+  virtual std::vector<PeriodicBoundary>
+  periodic_boundaries() const
+  {
+    return {};
+  }
+
+  // Boundaries with a Neumann datum.
+  virtual std::set<types::boundary_id>
+  neumann_boundary_ids() const
+  {
+    return {};
+  }
+
+  // Neumann datum h(x) (dim components).
+  virtual const Function<dim> &
+  neumann_function() const
+  {
+    return zero_function;
+  }
+
+  // Boundaries with backflow stabilization.
+  virtual std::set<types::boundary_id>
+  backflow_boundary_ids() const
+  {
+    return {};
+  }
+
+  // Forcing term f(x) (dim components).
+  virtual const Function<dim> &
+  forcing_term() const
+  {
+    return zero_function;
+  }
+
+  // Initial condition (dim + 1 components).
+  virtual const Function<dim> &
+  initial_condition() const
+  {
+    return zero_function;
+  }
+
+  // Exact solution (dim + 1 components), null if not known.
+  virtual const Function<dim> *
+  exact_solution() const
+  {
+    return nullptr;
+  }
+
+  // Obstacle on which drag and lift are computed, invalid if there is none.
+  virtual types::boundary_id
+  obstacle_boundary_id() const
+  {
+    return numbers::invalid_boundary_id;
+  }
+
+  // Reference force used to turn drag and lift into coefficients.
+  virtual double
+  reference_force() const
+  {
+    return 1.0;
+  }
+
+  // Forces are computed only after this time (to skip the start-up transient).
+  virtual double
+  forces_start_time() const
+  {
+    return 0.0;
+  }
+
+  // Points where the pressure difference P(A) - P(B) is evaluated.
+  virtual std::vector<Point<dim>>
+  pressure_probe_points() const
+  {
+    return {};
+  }
+
+  // Reynolds number at the current time (only used for logging).
+  virtual double
+  reynolds_number() const
+  {
+    return 0.0;
+  }
+
+  // Directory where the solution is written.
+  virtual std::string
+  output_directory() const
+  {
+    return "./output-" + name() + "/";
+  }
+
+  // Number of time steps between two outputs.
+  virtual unsigned int
+  output_interval() const
+  {
+    return 1;
+  }
+
+protected:
+  Functions::ZeroFunction<dim> zero_function;
+};
+
+#endif
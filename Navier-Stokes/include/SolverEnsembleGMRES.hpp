@@ -0,0 +1,341 @@
+#ifndef SOLVER_ENSEMBLE_GMRES_HPP
+#define SOLVER_ENSEMBLE_GMRES_HPP
+
+#include "IncludesFile.hpp"
+#include "SolverPipelined.hpp"
+#include <Epetra_MultiVector.h>
+using namespace dealii;
+
+// Flexible GMRES for several right-hand sides of the same block system
+// (members of an ensemble), run in lockstep.
+//
+// Each member keeps its own Krylov basis, but the members advance
+// together: at each iteration the products with the matrix of all the
+// members are done as one multivector product (each block of the matrix
+// is read once for all of them), and the projections and norms of all the
+// members are reduced together, as in SolverLowSyncGMRES (classical
+// Gram-Schmidt with the norm from Pythagoras, a second pass for the
+// members with cancellation). The preconditioner, whose setup is shared,
+// is applied member by member: the block preconditioners contain inner
+// iterative solves on single vectors. A member leaves the lockstep when
+// it converges.
+class SolverEnsembleGMRES
+{
+public:
+  using VectorType = TrilinosWrappers::MPI::BlockVector;
+
+  struct AdditionalData
+  {
+    AdditionalData(const unsigned int &max_basis_size_ = 30)
+      : max_basis_size(max_basis_size_)
+    {
+    }
+
+    // Number of Arnoldi vectors before a restart.
+    unsigned int max_basis_size;
+  };
+
+  // One solver control per member.
+  SolverEnsembleGMRES(std::vector<SolverControl> &solver_controls_,
+                      const AdditionalData &data_ = AdditionalData())
+    : solver_controls(solver_controls_)
+    , data(data_)
+  {
+  }
+
+  template <typename PreconditionerType>
+  void
+  solve(const TrilinosWrappers::BlockSparseMatrix &A,
+        const std::vector<VectorType *> &x,
+        const std::vector<const VectorType *> &b,
+        const PreconditionerType &preconditioner)
+  {
+    AssertDimension(x.size(), b.size());
+    AssertDimension(x.size(), solver_controls.size());
+
+    const unsigned int n_members = x.size();
+    const unsigned int m = data.max_basis_size;
+    const MPI_Comm comm = mpi_communicator(*b[0]);
+
+    std::vector<Member> members(n_members);
+    for (Member &member : members)
+    {
+      for (unsigned int i = 0; i <= m; ++i)
+      {
+        member.V.emplace_back(memory);
+        member.V.back()->reinit(*b[0], true);
+      }
+      for (unsigned int i = 0; i < m; ++i)
+      {
+        member.Z.emplace_back(memory);
+        member.Z.back()->reinit(*b[0], true);
+      }
+      member.R.reinit(m + 1, m);
+      member.g.reinit(m + 1);
+      member.givens_c.resize(m);
+      member.givens_s.resize(m);
+    }
+
+    std::vector<unsigned int> active(n_members);
+    std::iota(active.begin(), active.end(), 0);
+
+    // True residuals of the active members (in V[0]) and their norms.
+    const auto compute_residuals = [&]() {
+      std::vector<VectorType *> residuals;
+      std::vector<const VectorType *> solutions;
+      for (const unsigned int k : active)
+      {
+        residuals.push_back(members[k].V[0].get());
+        solutions.push_back(x[k]);
+      }
+      vmult(A, residuals, solutions);
+
+      std::vector<double> norms;
+      for (const unsigned int k : active)
+      {
+        members[k].V[0]->sadd(-1.0, *b[k]);
+        norms.push_back(local_dot(*members[k].V[0], *members[k].V[0]));
+      }
+      MPI_Allreduce(MPI_IN_PLACE, norms.data(), norms.size(), MPI_DOUBLE, MPI_SUM, comm);
+      for (unsigned int a = 0; a < active.size(); ++a)
+        members[active[a]].residual_norm = std::sqrt(norms[a]);
+    };
+
+    // x += Z y for the first n vectors of the cycle.
+    const auto update_solution = [&](const unsigned int &k, const unsigned int &n) {
+      Member &member = members[k];
+      Vector<double> y(n);
+      for (int i = n - 1; i >= 0; --i)
+      {
+        double sum = member.g(i);
+        for (unsigned int l = i + 1; l < n; ++l)
+          sum -= member.R(i, l) * y(l);
+        y(i) = sum / member.R(i, i);
+      }
+      for (unsigned int i = 0; i < n; ++i)
+        x[k]->add(y(i), *member.Z[i]);
+    };
+
+    // Keep the members which are still iterating.
+    const auto check_members = [&]() {
+      std::vector<unsigned int> iterating;
+      for (const unsigned int k : active)
+      {
+        members[k].state = solver_controls[k].check(members[k].iteration, members[k].residual_norm);
+        if (members[k].state == SolverControl::iterate)
+          iterating.push_back(k);
+      }
+      return iterating;
+    };
+
+    compute_residuals();
+    active = check_members();
+
+    std::vector<double> dots;
+    std::vector<VectorType *> products;
+    std::vector<const VectorType *> directions;
+    while (!active.empty())
+    {
+      for (const unsigned int k : active)
+      {
+        Member &member = members[k];
+        member.R = 0.0;
+        member.g = 0.0;
+        member.g(0) = member.residual_norm;
+        *member.V[0] /= member.residual_norm;
+      }
+
+      unsigned int n = 0;
+      while (n < m && !active.empty())
+      {
+        const unsigned int j = n;
+
+        // Preconditioner member by member, then one product for all.
+        products.clear();
+        directions.clear();
+        for (const unsigned int k : active)
+        {
+          preconditioner.vmult(*members[k].Z[j], *members[k].V[j]);
+          products.push_back(members[k].V[j + 1].get());
+          directions.push_back(members[k].Z[j].get());
+        }
+        vmult(A, products, directions);
+
+        // h = V^T w and |w|^2 of all the members in one reduction.
+        dots.assign(active.size() * (j + 2), 0.0);
+        for (unsigned int a = 0; a < active.size(); ++a)
+        {
+          const Member &member = members[active[a]];
+          const VectorType &w = *member.V[j + 1];
+          for (unsigned int i = 0; i <= j; ++i)
+            dots[a * (j + 2) + i] = local_dot(*member.V[i], w);
+          dots[a * (j + 2) + j + 1] = local_dot(w, w);
+        }
+        MPI_Allreduce(MPI_IN_PLACE, dots.data(), dots.size(), MPI_DOUBLE, MPI_SUM, comm);
+
+        std::vector<double> norms_squared(active.size());
+        std::vector<unsigned int> second_pass;
+        for (unsigned int a = 0; a < active.size(); ++a)
+        {
+          Member &member = members[active[a]];
+          const double *h = &dots[a * (j + 2)];
+          norms_squared[a] = h[j + 1];
+          for (unsigned int i = 0; i <= j; ++i)
+          {
+            member.R(i, j) = h[i];
+            member.V[j + 1]->add(-h[i], *member.V[i]);
+            norms_squared[a] -= h[i] * h[i];
+          }
+          if (norms_squared[a] < 0.5 * h[j + 1])
+            second_pass.push_back(a);
+        }
+
+        // Second pass of the members whose projection removed most of w.
+        if (!second_pass.empty())
+        {
+          dots.assign(second_pass.size() * (j + 2), 0.0);
+          for (unsigned int p = 0; p < second_pass.size(); ++p)
+          {
+            const Member &member = members[active[second_pass[p]]];
+            const VectorType &w = *member.V[j + 1];
+            for (unsigned int i = 0; i <= j; ++i)
+              dots[p * (j + 2) + i] = local_dot(*member.V[i], w);
+            dots[p * (j + 2) + j + 1] = local_dot(w, w);
+          }
+          MPI_Allreduce(MPI_IN_PLACE, dots.data(), dots.size(), MPI_DOUBLE, MPI_SUM, comm);
+
+          for (unsigned int p = 0; p < second_pass.size(); ++p)
+          {
+            const unsigned int a = second_pass[p];
+            Member &member = members[active[a]];
+            const double *h = &dots[p * (j + 2)];
+            norms_squared[a] = h[j + 1];
+            for (unsigned int i = 0; i <= j; ++i)
+            {
+              member.R(i, j) += h[i];
+              member.V[j + 1]->add(-h[i], *member.V[i]);
+              norms_squared[a] -= h[i] * h[i];
+            }
+          }
+        }
+
+        for (unsigned int a = 0; a < active.size(); ++a)
+        {
+          Member &member = members[active[a]];
+          FullMatrix<double> &R = member.R;
+
+          R(j + 1, j) = std::sqrt(std::max(norms_squared[a], 0.0));
+          if (R(j + 1, j) > 0.0)
+            *member.V[j + 1] /= R(j + 1, j);
+
+          // Update the QR factorization of H and the residual estimate.
+          for (unsigned int i = 0; i < j; ++i)
+          {
+            const double tmp = member.givens_c[i] * R(i, j) + member.givens_s[i] * R(i + 1, j);
+            R(i + 1, j) = -member.givens_s[i] * R(i, j) + member.givens_c[i] * R(i + 1, j);
+            R(i, j) = tmp;
+          }
+          const double denominator = std::hypot(R(j, j), R(j + 1, j));
+          member.givens_c[j] = R(j, j) / denominator;
+          member.givens_s[j] = R(j + 1, j) / denominator;
+          R(j, j) = denominator;
+          R(j + 1, j) = 0.0;
+          member.g(j + 1) = -member.givens_s[j] * member.g(j);
+          member.g(j) = member.givens_c[j] * member.g(j);
+
+          member.residual_norm = std::abs(member.g(j + 1));
+          ++member.iteration;
+        }
+        ++n;
+
+        // The members which stop leave the lockstep with their update.
+        const std::vector<unsigned int> iterating = check_members();
+        for (const unsigned int k : active)
+          if (members[k].state != SolverControl::iterate)
+            update_solution(k, n);
+        active = iterating;
+      }
+
+      if (active.empty())
+        break;
+
+      // Restart from the true residuals.
+      for (const unsigned int k : active)
+        update_solution(k, n);
+      compute_residuals();
+      active = check_members();
+    }
+
+    for (unsigned int k = 0; k < n_members; ++k)
+      AssertThrow(members[k].state == SolverControl::success,
+                  SolverControl::NoConvergence(solver_controls[k].last_step(),
+                                               solver_controls[k].last_value()));
+  }
+
+protected:
+  // Krylov basis, preconditioned vectors and QR factorization of the
+  // Hessenberg matrix of a member.
+  struct Member
+  {
+    std::vector<typename VectorMemory<VectorType>::Pointer> V, Z;
+    FullMatrix<double> R;
+    Vector<double> g;
+    std::vector<double> givens_c, givens_s;
+    double residual_norm = 0.0;
+    unsigned int iteration = 0;
+    SolverControl::State state = SolverControl::iterate;
+  };
+
+  // y_k = A x_k for all k: each block of A multiplies the multivector
+  // viewing the corresponding blocks of all the x_k.
+  void
+  vmult(const TrilinosWrappers::BlockSparseMatrix &A,
+        const std::vector<VectorType *> &y,
+        const std::vector<const VectorType *> &x) const
+  {
+    const int n_columns = x.size();
+    std::vector<double *> x_columns(n_columns), y_columns(n_columns);
+    products_workspace.resize(A.n_block_rows());
+
+    for (unsigned int row = 0; row < A.n_block_rows(); ++row)
+    {
+      for (int k = 0; k < n_columns; ++k)
+        y_columns[k] = y[k]->block(row).trilinos_vector()[0];
+      Epetra_MultiVector y_view(View, y[0]->block(row).trilinos_vector().Map(),
+                                y_columns.data(), n_columns);
+      y_view.PutScalar(0.0);
+
+      // Reallocated only when the number of members or the layout changes.
+      std::unique_ptr<Epetra_MultiVector> &product = products_workspace[row];
+      if (!product || product->NumVectors() != n_columns || !product->Map().SameAs(y_view.Map()))
+        product = std::make_unique<Epetra_MultiVector>(y_view.Map(), n_columns, false);
+
+      for (unsigned int col = 0; col < A.n_block_cols(); ++col)
+      {
+        const Epetra_CrsMatrix &block = A.block(row, col).trilinos_matrix();
+        if (block.NumGlobalNonzeros() == 0)
+          continue;
+
+        for (int k = 0; k < n_columns; ++k)
+          x_columns[k] = x[k]->block(col).trilinos_vector()[0];
+        Epetra_MultiVector x_view(View, x[0]->block(col).trilinos_vector().Map(),
+                                  x_columns.data(), n_columns);
+
+        const int ierr = block.Multiply(false, x_view, *product);
+        AssertThrow(ierr == 0, ExcTrilinosError(ierr));
+        y_view.Update(1.0, *product, 1.0);
+      }
+    }
+  }
+
+  std::vector<SolverControl> &solver_controls;
+
+  const AdditionalData data;
+
+  GrowingVectorMemory<VectorType> memory;
+
+  // Products of the blocks of each block row of A with the members.
+  mutable std::vector<std::unique_ptr<Epetra_MultiVector>> products_workspace;
+};
+
+#endif
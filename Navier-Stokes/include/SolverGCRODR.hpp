@@ -0,0 +1,408 @@
+#ifndef SOLVER_GCRODR_HPP
+#define SOLVER_GCRODR_HPP
+
+#include "IncludesFile.hpp"
+#include "SolverPipelined.hpp"
+using namespace dealii;
+
+// Krylov subspace recycling solver GCRO-DR (Parks, de Sturler, Mackey,
+// Johnson, Maiti, 2006) for the outer block system.
+//
+// Consecutive time steps solve nearly identical systems. GCRO-DR keeps a
+// small subspace U (with C = A U orthonormal) spanned by harmonic Ritz
+// vectors associated to the eigenvalues of smallest magnitude, i.e. the
+// ones that slow down GMRES. At the next solve the new A is applied to U,
+// the initial residual is projected out of C and the GMRES cycle runs on
+// (I - C C^T) A, so that those eigenvalues are deflated from the start.
+//
+// The block preconditioners are inexact (they contain inner iterative
+// solves), so the solver uses the flexible variant with right
+// preconditioning: the preconditioned vectors Z are stored next to the
+// Arnoldi basis V. The residual checked by the SolverControl is therefore
+// the true (unpreconditioned) residual.
+class SolverGCRODR
+{
+public:
+  using VectorType = TrilinosWrappers::MPI::BlockVector;
+
+  struct AdditionalData
+  {
+    AdditionalData(const unsigned int &max_basis_size_ = 30,
+                   const unsigned int &n_recycled_vectors_ = 5)
+      : max_basis_size(max_basis_size_)
+      , n_recycled_vectors(n_recycled_vectors_)
+    {
+    }
+
+    // Number of Arnoldi vectors before a restart.
+    unsigned int max_basis_size;
+
+    // Dimension of the recycled subspace.
+    unsigned int n_recycled_vectors;
+  };
+
+  // Recycled subspace, kept from one solve to the next, together with the
+  // workspace of the Arnoldi process.
+  class RecycleSpace
+  {
+  public:
+    // Forget the recycled subspace (e.g. after a change of the mesh).
+    void
+    clear()
+    {
+      U.clear();
+      C.clear();
+      V.clear();
+      Z.clear();
+    }
+
+    unsigned int
+    size() const
+    {
+      return U.size();
+    }
+
+    // Recycled vectors and their images, A U = C with C orthonormal.
+    std::vector<VectorType> U;
+    std::vector<VectorType> C;
+
+    // Arnoldi basis and preconditioned vectors.
+    std::vector<VectorType> V;
+    std::vector<VectorType> Z;
+  };
+
+  SolverGCRODR(SolverControl &solver_control_,
+               RecycleSpace &recycle_space_,
+               const AdditionalData &data_ = AdditionalData())
+    : solver_control(solver_control_)
+    , recycle_space(recycle_space_)
+    , data(data_)
+  {
+    AssertThrow(data.max_basis_size > data.n_recycled_vectors,
+                ExcMessage("The basis must be larger than the recycled subspace."));
+  }
+
+  template <typename MatrixType, typename PreconditionerType>
+  void
+  solve(const MatrixType &A,
+        VectorType &x,
+        const VectorType &b,
+        const PreconditionerType &preconditioner)
+  {
+    const unsigned int m = data.max_basis_size;
+
+    std::vector<VectorType> &U = recycle_space.U;
+    std::vector<VectorType> &C = recycle_space.C;
+    std::vector<VectorType> &V = recycle_space.V;
+    std::vector<VectorType> &Z = recycle_space.Z;
+
+    if (V.size() != m + 1 || V[0].size() != b.size())
+    {
+      V.assign(m + 1, b);
+      Z.assign(m, b);
+    }
+
+    // Residual of the initial guess.
+    VectorType r(b);
+    A.vmult(r, x);
+    r.sadd(-1.0, b);
+
+    // The matrix has changed since the recycled subspace was computed:
+    // C = A U, orthonormalized together with U.
+    for (unsigned int i = 0; i < U.size(); ++i)
+      A.vmult(C[i], U[i]);
+    orthonormalize_recycle_space();
+    project_out_recycle_space(x, r);
+
+    double residual_norm = r.l2_norm();
+    unsigned int iteration = 0;
+    SolverControl::State state = solver_control.check(iteration, residual_norm);
+
+    while (state == SolverControl::iterate)
+    {
+      const unsigned int k = U.size();
+
+      // Hessenberg matrix, its QR factorization through Givens rotations,
+      // and the projections C^T A Z of the new directions.
+      FullMatrix<double> H(m + 1, m);
+      FullMatrix<double> R(m + 1, m);
+      FullMatrix<double> B_k(k, m);
+      Vector<double> g(m + 1);
+      std::vector<double> givens_c(m), givens_s(m);
+
+      g(0) = residual_norm;
+      V[0].equ(1.0 / residual_norm, r);
+
+      unsigned int n = 0;
+      while (n < m && state == SolverControl::iterate)
+      {
+        const unsigned int j = n;
+
+        preconditioner.vmult(Z[j], V[j]);
+        A.vmult(V[j + 1], Z[j]);
+
+        // Orthogonalize against the recycled images, then against V.
+        for (unsigned int i = 0; i < k; ++i)
+        {
+          B_k(i, j) = C[i] * V[j + 1];
+          V[j + 1].add(-B_k(i, j), C[i]);
+        }
+        for (unsigned int i = 0; i <= j; ++i)
+        {
+          H(i, j) = V[i] * V[j + 1];
+          V[j + 1].add(-H(i, j), V[i]);
+        }
+        H(j + 1, j) = V[j + 1].l2_norm();
+        if (H(j + 1, j) > 0.0)
+          V[j + 1] /= H(j + 1, j);
+
+        // Update the QR factorization of H and the residual estimate.
+        for (unsigned int i = 0; i <= j + 1; ++i)
+          R(i, j) = H(i, j);
+        for (unsigned int i = 0; i < j; ++i)
+        {
+          const double tmp = givens_c[i] * R(i, j) + givens_s[i] * R(i + 1, j);
+          R(i + 1, j) = -givens_s[i] * R(i, j) + givens_c[i] * R(i + 1, j);
+          R(i, j) = tmp;
+        }
+        const double denominator = std::hypot(R(j, j), R(j + 1, j));
+        givens_c[j] = R(j, j) / denominator;
+        givens_s[j] = R(j + 1, j) / denominator;
+        R(j, j) = denominator;
+        R(j + 1, j) = 0.0;
+        g(j + 1) = -givens_s[j] * g(j);
+        g(j) = givens_c[j] * g(j);
+
+        residual_norm = std::abs(g(j + 1));
+        ++n;
+        state = solver_control.check(++iteration, residual_norm);
+      }
+
+      // y = R^-1 g, then x += Z y - U (B_k y).
+      Vector<double> y(n);
+      for (int i = n - 1; i >= 0; --i)
+      {
+        double sum = g(i);
+        for (unsigned int l = i + 1; l < n; ++l)
+          sum -= R(i, l) * y(l);
+        y(i) = sum / R(i, i);
+      }
+      for (unsigned int i = 0; i < n; ++i)
+        x.add(y(i), Z[i]);
+      for (unsigned int l = 0; l < k; ++l)
+      {
+        double sum = 0.0;
+        for (unsigned int i = 0; i < n; ++i)
+          sum += B_k(l, i) * y(i);
+        x.add(-sum, U[l]);
+      }
+
+      // New recycled subspace from the search space of this cycle.
+      if (data.n_recycled_vectors > 0 && n > data.n_recycled_vectors)
+        update_recycle_space(n, H, B_k);
+
+      if (state != SolverControl::iterate)
+        break;
+
+      // Restart from the true residual.
+      A.vmult(r, x);
+      r.sadd(-1.0, b);
+      project_out_recycle_space(x, r);
+      residual_norm = r.l2_norm();
+    }
+
+    AssertThrow(state == SolverControl::success,
+                SolverControl::NoConvergence(solver_control.last_step(),
+                                             solver_control.last_value()));
+  }
+
+protected:
+  // Modified Gram-Schmidt on C, with the same operations on U so that
+  // A U = C still holds. Dependent vectors are dropped.
+  void
+  orthonormalize_recycle_space()
+  {
+    std::vector<VectorType> &U = recycle_space.U;
+    std::vector<VectorType> &C = recycle_space.C;
+
+    for (unsigned int i = 0; i < C.size();)
+    {
+      for (unsigned int l = 0; l < i; ++l)
+      {
+        const double r = C[l] * C[i];
+        C[i].add(-r, C[l]);
+        U[i].add(-r, U[l]);
+      }
+
+      const double norm = C[i].l2_norm();
+      if (norm < 1e-12)
+      {
+        C.erase(C.begin() + i);
+        U.erase(U.begin() + i);
+        continue;
+      }
+      C[i] /= norm;
+      U[i] /= norm;
+      ++i;
+    }
+  }
+
+  // x += U C^T r, r -= C C^T r.
+  void
+  project_out_recycle_space(VectorType &x, VectorType &r) const
+  {
+    for (unsigned int i = 0; i < recycle_space.size(); ++i)
+    {
+      const double alpha = recycle_space.C[i] * r;
+      x.add(alpha, recycle_space.U[i]);
+      r.add(-alpha, recycle_space.C[i]);
+    }
+  }
+
+  // Harmonic Ritz vectors of A on the search space W = [U, Z] of the last
+  // cycle, with A W = Vh G, Vh = [C, V] orthonormal and
+  // G = [I, B_k; 0, H]. They solve G^T G g = theta G^T (Vh^T W) g; the
+  // vectors of the smallest |theta| become the new U, and the new C comes
+  // from a QR factorization of G P, without products with A.
+  void
+  update_recycle_space(const unsigned int &n,
+                       const FullMatrix<double> &H,
+                       const FullMatrix<double> &B_k)
+  {
+    std::vector<VectorType> &U = recycle_space.U;
+    std::vector<VectorType> &C = recycle_space.C;
+    const std::vector<VectorType> &V = recycle_space.V;
+    const std::vector<VectorType> &Z = recycle_space.Z;
+
+    const unsigned int k = U.size();
+    const unsigned int s = k + n;
+
+    const auto W = [&](const unsigned int &i) -> const VectorType & {
+      return i < k ? U[i] : Z[i - k];
+    };
+    const auto Vh = [&](const unsigned int &i) -> const VectorType & {
+      return i < k ? C[i] : V[i - k];
+    };
+
+    // G, (s + 1) x s.
+    FullMatrix<double> G(s + 1, s);
+    for (unsigned int i = 0; i < k; ++i)
+    {
+      G(i, i) = 1.0;
+      for (unsigned int j = 0; j < n; ++j)
+        G(i, k + j) = B_k(i, j);
+    }
+    for (unsigned int i = 0; i <= n; ++i)
+      for (unsigned int j = 0; j < n; ++j)
+        G(k + i, k + j) = H(i, j);
+
+    // Vh^T W, all the dot products with a single reduction.
+    std::vector<double> products((s + 1) * s);
+    for (unsigned int i = 0; i <= s; ++i)
+      for (unsigned int j = 0; j < s; ++j)
+        products[i * s + j] = local_dot(Vh(i), W(j));
+    MPI_Allreduce(MPI_IN_PLACE, products.data(), products.size(), MPI_DOUBLE,
+                  MPI_SUM, V[0].block(0).get_mpi_communicator());
+    FullMatrix<double> VhW(s + 1, s);
+    for (unsigned int i = 0; i <= s; ++i)
+      for (unsigned int j = 0; j < s; ++j)
+        VhW(i, j) = products[i * s + j];
+
+    // mu = 1 / theta are the eigenvalues of (G^T G)^-1 G^T (Vh^T W).
+    FullMatrix<double> GtG(s, s), GtVhW(s, s);
+    G.Tmmult(GtG, G);
+    G.Tmmult(GtVhW, VhW);
+
+    LAPACKFullMatrix<double> GtG_lu(s, s);
+    GtG_lu = GtG;
+    GtG_lu.compute_lu_factorization();
+
+    LAPACKFullMatrix<double> eigen_matrix(s, s);
+    for (unsigned int j = 0; j < s; ++j)
+    {
+      Vector<double> column(s);
+      for (unsigned int i = 0; i < s; ++i)
+        column(i) = GtVhW(i, j);
+      GtG_lu.solve(column);
+      for (unsigned int i = 0; i < s; ++i)
+        eigen_matrix(i, j) = column(i);
+    }
+    eigen_matrix.compute_eigenvalues(true, false);
+    const FullMatrix<std::complex<double>> eigenvectors =
+        eigen_matrix.get_right_eigenvectors();
+
+    std::vector<unsigned int> order(s);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](const unsigned int &a, const unsigned int &b) {
+      return std::abs(eigen_matrix.eigenvalue(a)) > std::abs(eigen_matrix.eigenvalue(b));
+    });
+
+    // Real basis of the selected eigenvectors: a complex pair gives its
+    // real and imaginary parts.
+    std::vector<Vector<double>> P;
+    for (const unsigned int &index : order)
+    {
+      if (P.size() >= data.n_recycled_vectors)
+        break;
+
+      const std::complex<double> mu = eigen_matrix.eigenvalue(index);
+      if (mu.imag() < 0.0)
+        continue;
+
+      Vector<double> real_part(s), imag_part(s);
+      for (unsigned int i = 0; i < s; ++i)
+      {
+        real_part(i) = eigenvectors(i, index).real();
+        imag_part(i) = eigenvectors(i, index).imag();
+      }
+      P.push_back(real_part);
+      if (mu.imag() > 0.0 && P.size() < data.n_recycled_vectors)
+        P.push_back(imag_part);
+    }
+
+    // QR factorization of G P (modified Gram-Schmidt), P <- P R^-1.
+    std::vector<Vector<double>> Q;
+    std::vector<Vector<double>> T;
+    for (Vector<double> &p : P)
+    {
+      Vector<double> q(s + 1);
+      G.vmult(q, p);
+      for (unsigned int l = 0; l < Q.size(); ++l)
+      {
+        const double r = Q[l] * q;
+        q.add(-r, Q[l]);
+        p.add(-r, T[l]);
+      }
+      const double norm = q.l2_norm();
+      if (norm < 1e-12)
+        continue;
+      q /= norm;
+      p /= norm;
+      Q.push_back(q);
+      T.push_back(p);
+    }
+
+    // U = W T, C = Vh Q.
+    std::vector<VectorType> U_new(T.size(), V[0]);
+    std::vector<VectorType> C_new(Q.size(), V[0]);
+    for (unsigned int l = 0; l < T.size(); ++l)
+    {
+      U_new[l] = 0.0;
+      C_new[l] = 0.0;
+      for (unsigned int i = 0; i < s; ++i)
+        U_new[l].add(T[l](i), W(i));
+      for (unsigned int i = 0; i <= s; ++i)
+        C_new[l].add(Q[l](i), Vh(i));
+    }
+    U.swap(U_new);
+    C.swap(C_new);
+  }
+
+  SolverControl &solver_control;
+
+  RecycleSpace &recycle_space;
+
+  const AdditionalData data;
+};
+
+#endif
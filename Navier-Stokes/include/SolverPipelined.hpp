@@ -0,0 +1,530 @@
+#ifndef SOLVER_PIPELINED_HPP
+#define SOLVER_PIPELINED_HPP
+
+#include "IncludesFile.hpp"
+using namespace dealii;
+
+// Low synchronization Krylov solvers for large numbers of processes, where
+// the global reductions of the classical solvers (one MPI_Allreduce per dot
+// product) dominate the cost of an iteration.
+
+// Local part of the dot products (no communication), also used by the
+// recycling and ensemble solvers to batch their reductions.
+inline double
+local_dot(const TrilinosWrappers::MPI::Vector &a,
+          const TrilinosWrappers::MPI::Vector &b)
+{
+  const Epetra_MultiVector &a_epetra = a.trilinos_vector();
+  const double *a_values = a_epetra[0];
+  const double *b_values = b.trilinos_vector()[0];
+  double result = 0.0;
+  for (int i = 0; i < a_epetra.MyLength(); ++i)
+    result += a_values[i] * b_values[i];
+  return result;
+}
+
+inline double
+local_dot(const TrilinosWrappers::MPI::BlockVector &a,
+          const TrilinosWrappers::MPI::BlockVector &b)
+{
+  double result = 0.0;
+  for (unsigned int block = 0; block < a.n_blocks(); ++block)
+    result += local_dot(a.block(block), b.block(block));
+  return result;
+}
+
+inline MPI_Comm
+mpi_communicator(const TrilinosWrappers::MPI::Vector &v)
+{
+  return v.get_mpi_communicator();
+}
+
+inline MPI_Comm
+mpi_communicator(const TrilinosWrappers::MPI::BlockVector &v)
+{
+  return v.block(0).get_mpi_communicator();
+}
+
+
+// Pipelined preconditioned conjugate gradient (Ghysels, Vanroose, 2014).
+//
+// The three dot products of an iteration are combined in a single
+// non-blocking reduction, which proceeds while the preconditioner and the
+// matrix are applied to the next direction. The recurrences need a fixed
+// (linear) preconditioner, as the ILU of the inner Schur solves.
+template <typename VectorType>
+class SolverPipelinedCG
+{
+public:
+  SolverPipelinedCG(SolverControl &solver_control_)
+    : solver_control(solver_control_)
+  {
+  }
+
+  template <typename MatrixType, typename PreconditionerType>
+  void
+  solve(const MatrixType &A,
+        VectorType &x,
+        const VectorType &b,
+        const PreconditionerType &preconditioner)
+  {
+    typename VectorMemory<VectorType>::Pointer r(memory), u(memory), w(memory),
+        m(memory), n(memory), p(memory), s(memory), q(memory), z(memory);
+    for (VectorType *v : {r.get(), u.get(), w.get(), m.get(), n.get(),
+                          p.get(), s.get(), q.get(), z.get()})
+      v->reinit(b);
+
+    // r = b - A x, u = M r, w = A u.
+    A.vmult(*r, x);
+    r->sadd(-1.0, b);
+    preconditioner.vmult(*u, *r);
+    A.vmult(*w, *u);
+
+    const MPI_Comm comm = mpi_communicator(b);
+    double gamma_old = 0.0, alpha = 0.0;
+    SolverControl::State state = SolverControl::iterate;
+
+    for (unsigned int iteration = 0; state == SolverControl::iterate; ++iteration)
+    {
+      // (r, u), (w, u), (r, r), reduced while m = M w and n = A m are
+      // computed.
+      double dots[3] = {local_dot(*r, *u), local_dot(*w, *u), local_dot(*r, *r)};
+      MPI_Request request;
+      MPI_Iallreduce(MPI_IN_PLACE, dots, 3, MPI_DOUBLE, MPI_SUM, comm, &request);
+
+      preconditioner.vmult(*m, *w);
+      A.vmult(*n, *m);
+
+      MPI_Wait(&request, MPI_STATUS_IGNORE);
+      const double gamma = dots[0];
+      const double delta = dots[1];
+
+      state = solver_control.check(iteration, std::sqrt(dots[2]));
+      if (state != SolverControl::iterate)
+        break;
+
+      double beta = 0.0;
+      if (iteration > 0)
+      {
+        beta = gamma / gamma_old;
+        alpha = gamma / (delta - beta * gamma / alpha);
+      }
+      else
+        alpha = gamma / delta;
+      gamma_old = gamma;
+
+      z->sadd(beta, 1.0, *n);
+      q->sadd(beta, 1.0, *m);
+      s->sadd(beta, 1.0, *w);
+      p->sadd(beta, 1.0, *u);
+
+      x.add(alpha, *p);
+      r->add(-alpha, *s);
+      u->add(-alpha, *q);
+      w->add(-alpha, *z);
+    }
+
+    AssertThrow(state == SolverControl::success,
+                SolverControl::NoConvergence(solver_control.last_step(),
+                                             solver_control.last_value()));
+  }
+
+protected:
+  SolverControl &solver_control;
+
+  GrowingVectorMemory<VectorType> memory;
+};
+
+
+// Restarted flexible GMRES with a single global reduction per iteration.
+//
+// The new direction is orthogonalized with classical Gram-Schmidt: the
+// projections on the basis and the norm of the direction are reduced
+// together, and the norm of the orthogonalized vector follows from
+// Pythagoras. When cancellation is detected (the norm drops below
+// 1/sqrt(2) of the original one) a second pass is done, as in CGS2, at the
+// cost of a second reduction. Modified Gram-Schmidt needs j + 2 reductions
+// at iteration j. The preconditioned vectors are stored, so the
+// preconditioner may change from one application to the next. This is the
+// solver of the outer system: the block preconditioners contain inner
+// iterative solves, which rules out the pipelined recurrence of
+// SolverPipelinedGMRES, and the reduction stays blocking.
+template <typename VectorType>
+class SolverLowSyncGMRES
+{
+public:
+  struct AdditionalData
+  {
+    AdditionalData(const unsigned int &max_basis_size_ = 30)
+      : max_basis_size(max_basis_size_)
+    {
+    }
+
+    // Number of Arnoldi vectors before a restart.
+    unsigned int max_basis_size;
+  };
+
+  SolverLowSyncGMRES(SolverControl &solver_control_,
+                     const AdditionalData &data_ = AdditionalData())
+    : solver_control(solver_control_)
+    , data(data_)
+  {
+  }
+
+  template <typename MatrixType, typename PreconditionerType>
+  void
+  solve(const MatrixType &A,
+        VectorType &x,
+        const VectorType &b,
+        const PreconditionerType &preconditioner)
+  {
+    const unsigned int m = data.max_basis_size;
+    const MPI_Comm comm = mpi_communicator(b);
+
+    std::vector<typename VectorMemory<VectorType>::Pointer> V, Z;
+    for (unsigned int i = 0; i <= m; ++i)
+    {
+      V.emplace_back(memory);
+      V.back()->reinit(b, true);
+    }
+    for (unsigned int i = 0; i < m; ++i)
+    {
+      Z.emplace_back(memory);
+      Z.back()->reinit(b, true);
+    }
+
+    // Residual of the initial guess.
+    VectorType &r = *V[0];
+    A.vmult(r, x);
+    r.sadd(-1.0, b);
+    double residual_norm = r.l2_norm();
+
+    unsigned int iteration = 0;
+    SolverControl::State state = solver_control.check(iteration, residual_norm);
+
+    std::vector<double> dots(m + 2);
+    while (state == SolverControl::iterate)
+    {
+      FullMatrix<double> R(m + 1, m);
+      Vector<double> g(m + 1);
+      std::vector<double> givens_c(m), givens_s(m);
+
+      g(0) = residual_norm;
+      *V[0] /= residual_norm;
+
+      unsigned int n = 0;
+      while (n < m && state == SolverControl::iterate)
+      {
+        const unsigned int j = n;
+        VectorType &w = *V[j + 1];
+
+        preconditioner.vmult(*Z[j], *V[j]);
+        A.vmult(w, *Z[j]);
+
+        // h = V^T w and |w|^2 in one reduction.
+        for (unsigned int i = 0; i <= j; ++i)
+          dots[i] = local_dot(*V[i], w);
+        dots[j + 1] = local_dot(w, w);
+        MPI_Allreduce(MPI_IN_PLACE, dots.data(), j + 2, MPI_DOUBLE, MPI_SUM, comm);
+
+        const double w_norm_squared = dots[j + 1];
+        double norm_squared = w_norm_squared;
+        for (unsigned int i = 0; i <= j; ++i)
+        {
+          R(i, j) = dots[i];
+          w.add(-dots[i], *V[i]);
+          norm_squared -= dots[i] * dots[i];
+        }
+
+        // Second pass if the projection removed most of w.
+        if (norm_squared < 0.5 * w_norm_squared)
+        {
+          for (unsigned int i = 0; i <= j; ++i)
+            dots[i] = local_dot(*V[i], w);
+          dots[j + 1] = local_dot(w, w);
+          MPI_Allreduce(MPI_IN_PLACE, dots.data(), j + 2, MPI_DOUBLE, MPI_SUM, comm);
+
+          norm_squared = dots[j + 1];
+          for (unsigned int i = 0; i <= j; ++i)
+          {
+            R(i, j) += dots[i];
+            w.add(-dots[i], *V[i]);
+            norm_squared -= dots[i] * dots[i];
+          }
+        }
+
+        R(j + 1, j) = std::sqrt(std::max(norm_squared, 0.0));
+        if (R(j + 1, j) > 0.0)
+          w /= R(j + 1, j);
+
+        // Update the QR factorization of H and the residual estimate.
+        for (unsigned int i = 0; i < j; ++i)
+        {
+          const double tmp = givens_c[i] * R(i, j) + givens_s[i] * R(i + 1, j);
+          R(i + 1, j) = -givens_s[i] * R(i, j) + givens_c[i] * R(i + 1, j);
+          R(i, j) = tmp;
+        }
+        const double denominator = std::hypot(R(j, j), R(j + 1, j));
+        givens_c[j] = R(j, j) / denominator;
+        givens_s[j] = R(j + 1, j) / denominator;
+        R(j, j) = denominator;
+        R(j + 1, j) = 0.0;
+        g(j + 1) = -givens_s[j] * g(j);
+        g(j) = givens_c[j] * g(j);
+
+        residual_norm = std::abs(g(j + 1));
+        ++n;
+        state = solver_control.check(++iteration, residual_norm);
+      }
+
+      // y = R^-1 g, x += Z y.
+      Vector<double> y(n);
+      for (int i = n - 1; i >= 0; --i)
+      {
+        double sum = g(i);
+        for (unsigned int l = i + 1; l < n; ++l)
+          sum -= R(i, l) * y(l);
+        y(i) = sum / R(i, i);
+      }
+      for (unsigned int i = 0; i < n; ++i)
+        x.add(y(i), *Z[i]);
+
+      if (state != SolverControl::iterate)
+        break;
+
+      // Restart from the true residual.
+      A.vmult(r, x);
+      r.sadd(-1.0, b);
+      residual_norm = r.l2_norm();
+    }
+
+    AssertThrow(state == SolverControl::success,
+                SolverControl::NoConvergence(solver_control.last_step(),
+                                             solver_control.last_value()));
+  }
+
+protected:
+  SolverControl &solver_control;
+
+  const AdditionalData data;
+
+  GrowingVectorMemory<VectorType> memory;
+};
+
+
+// Pipelined GMRES, p(1)-GMRES (Ghysels, Ashby, Meerbergen, Vanroose, 2013),
+// right preconditioned by a fixed (linear) preconditioner M.
+//
+// With B = A M^-1 and z_j = B v_j, the projections of z_j on the basis and
+// its norm are reduced by a non-blocking reduction, which proceeds while
+// B z_j is computed. B v_{j+1} then follows from linearity,
+//
+//   B v_{j+1} = (B z_j - sum_i h_ij z_i) / h_{j+1,j},
+//
+// so each iteration applies A and M once and its only reduction is hidden
+// behind them. The norm of the orthogonalized vector follows from
+// Pythagoras; on cancellation a second, blocking, pass is done and B
+// v_{j+1} is computed explicitly. The recurrence needs M to be the same at
+// every application: this is the solver of the inner F solves (ILU), while
+// the outer solve uses SolverLowSyncGMRES.
+template <typename VectorType>
+class SolverPipelinedGMRES
+{
+public:
+  struct AdditionalData
+  {
+    AdditionalData(const unsigned int &max_basis_size_ = 30)
+      : max_basis_size(max_basis_size_)
+    {
+    }
+
+    // Number of Arnoldi vectors before a restart.
+    unsigned int max_basis_size;
+  };
+
+  SolverPipelinedGMRES(SolverControl &solver_control_,
+                       const AdditionalData &data_ = AdditionalData())
+    : solver_control(solver_control_)
+    , data(data_)
+  {
+  }
+
+  template <typename MatrixType, typename PreconditionerType>
+  void
+  solve(const MatrixType &A,
+        VectorType &x,
+        const VectorType &b,
+        const PreconditionerType &preconditioner)
+  {
+    const unsigned int m = data.max_basis_size;
+    const MPI_Comm comm = mpi_communicator(b);
+
+    // Basis V and Z[j] = B V[j].
+    std::vector<typename VectorMemory<VectorType>::Pointer> V, Z;
+    for (unsigned int i = 0; i <= m; ++i)
+    {
+      V.emplace_back(memory);
+      V.back()->reinit(b, true);
+    }
+    for (unsigned int i = 0; i < m; ++i)
+    {
+      Z.emplace_back(memory);
+      Z.back()->reinit(b, true);
+    }
+    typename VectorMemory<VectorType>::Pointer w(memory), tmp(memory);
+    w->reinit(b, true);
+    tmp->reinit(b, true);
+
+    const auto apply_B = [&](VectorType &dst, const VectorType &src) {
+      preconditioner.vmult(*tmp, src);
+      A.vmult(dst, *tmp);
+    };
+
+    // Residual of the initial guess.
+    VectorType &r = *V[0];
+    A.vmult(r, x);
+    r.sadd(-1.0, b);
+    double residual_norm = r.l2_norm();
+
+    unsigned int iteration = 0;
+    SolverControl::State state = solver_control.check(iteration, residual_norm);
+
+    std::vector<double> dots(m + 2);
+    while (state == SolverControl::iterate)
+    {
+      FullMatrix<double> R(m + 1, m);
+      Vector<double> g(m + 1);
+      std::vector<double> givens_c(m), givens_s(m);
+
+      g(0) = residual_norm;
+      *V[0] /= residual_norm;
+      apply_B(*Z[0], *V[0]);
+
+      unsigned int n = 0;
+      while (n < m && state == SolverControl::iterate)
+      {
+        const unsigned int j = n;
+        const VectorType &z = *Z[j];
+        VectorType &v = *V[j + 1];
+
+        // h = V^T z and |z|^2, reduced while w = B z is computed.
+        for (unsigned int i = 0; i <= j; ++i)
+          dots[i] = local_dot(*V[i], z);
+        dots[j + 1] = local_dot(z, z);
+        MPI_Request request;
+        MPI_Iallreduce(MPI_IN_PLACE, dots.data(), j + 2, MPI_DOUBLE, MPI_SUM, comm, &request);
+
+        if (j + 1 < m)
+          apply_B(*w, z);
+
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+
+        const double z_norm_squared = dots[j + 1];
+        double norm_squared = z_norm_squared;
+        v = z;
+        for (unsigned int i = 0; i <= j; ++i)
+        {
+          R(i, j) = dots[i];
+          v.add(-dots[i], *V[i]);
+          norm_squared -= dots[i] * dots[i];
+        }
+
+        // Second pass if the projection removed most of z: B v is then
+        // computed explicitly.
+        bool second_pass = false;
+        if (norm_squared < 0.5 * z_norm_squared)
+        {
+          second_pass = true;
+          for (unsigned int i = 0; i <= j; ++i)
+            dots[i] = local_dot(*V[i], v);
+          dots[j + 1] = local_dot(v, v);
+          MPI_Allreduce(MPI_IN_PLACE, dots.data(), j + 2, MPI_DOUBLE, MPI_SUM, comm);
+
+          norm_squared = dots[j + 1];
+          for (unsigned int i = 0; i <= j; ++i)
+          {
+            R(i, j) += dots[i];
+            v.add(-dots[i], *V[i]);
+            norm_squared -= dots[i] * dots[i];
+          }
+        }
+
+        R(j + 1, j) = std::sqrt(std::max(norm_squared, 0.0));
+        if (R(j + 1, j) > 0.0)
+        {
+          v /= R(j + 1, j);
+
+          // Next z = B v, before the rotations change the column of H.
+          if (j + 1 < m)
+          {
+            VectorType &z_next = *Z[j + 1];
+            if (second_pass)
+              apply_B(z_next, v);
+            else
+            {
+              z_next = *w;
+              for (unsigned int i = 0; i <= j; ++i)
+                z_next.add(-R(i, j), *Z[i]);
+              z_next /= R(j + 1, j);
+            }
+          }
+        }
+
+        // Update the QR factorization of H and the residual estimate.
+        for (unsigned int i = 0; i < j; ++i)
+        {
+          const double tmp_value = givens_c[i] * R(i, j) + givens_s[i] * R(i + 1, j);
+          R(i + 1, j) = -givens_s[i] * R(i, j) + givens_c[i] * R(i + 1, j);
+          R(i, j) = tmp_value;
+        }
+        const double denominator = std::hypot(R(j, j), R(j + 1, j));
+        givens_c[j] = R(j, j) / denominator;
+        givens_s[j] = R(j + 1, j) / denominator;
+        R(j, j) = denominator;
+        R(j + 1, j) = 0.0;
+        g(j + 1) = -givens_s[j] * g(j);
+        g(j) = givens_c[j] * g(j);
+
+        residual_norm = std::abs(g(j + 1));
+        ++n;
+        state = solver_control.check(++iteration, residual_norm);
+      }
+
+      // y = R^-1 g, x += M^-1 V y.
+      Vector<double> y(n);
+      for (int i = n - 1; i >= 0; --i)
+      {
+        double sum = g(i);
+        for (unsigned int l = i + 1; l < n; ++l)
+          sum -= R(i, l) * y(l);
+        y(i) = sum / R(i, i);
+      }
+      *w = 0.0;
+      for (unsigned int i = 0; i < n; ++i)
+        w->add(y(i), *V[i]);
+      preconditioner.vmult(*tmp, *w);
+      x += *tmp;
+
+      if (state != SolverControl::iterate)
+        break;
+
+      // Restart from the true residual.
+      A.vmult(r, x);
+      r.sadd(-1.0, b);
+      residual_norm = r.l2_norm();
+    }
+
+    AssertThrow(state == SolverControl::success,
+                SolverControl::NoConvergence(solver_control.last_step(),
+                                             solver_control.last_value()));
+  }
+
+protected:
+  SolverControl &solver_control;
+
+  const AdditionalData data;
+
+  GrowingVectorMemory<VectorType> memory;
+};
+
+#endif
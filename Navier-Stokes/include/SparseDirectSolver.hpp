@@ -0,0 +1,181 @@
+#ifndef SPARSE_DIRECT_SOLVER_HPP
+#define SPARSE_DIRECT_SOLVER_HPP
+
+#include "IncludesFile.hpp"
+using namespace dealii;
+
+// Sparse direct solver (Amesos: KLU, MUMPS, ...) for the block system.
+//
+// Amesos works on a single Epetra matrix, so the blocks are copied into a
+// monolithic matrix with the global numbering of the DoFs (the DoFs are
+// numbered component-wise, so the block of a DoF follows from its index).
+// The pattern of the system does not change during the simulation: the
+// symbolic factorization (ordering and analysis) is done once by
+// initialize(), each time step only copies the values and performs the
+// numeric factorization. TrilinosWrappers::SolverDirect repeats both of
+// them at each initialize(), hence the direct use of Amesos.
+class SparseDirectSolver
+{
+public:
+  SparseDirectSolver(const std::string &solver_type_ = "Amesos_Klu")
+    : solver_type(solver_type_)
+  {
+    Amesos factory;
+    AssertThrow(factory.Query(solver_type),
+                ExcMessage("The Amesos solver " + solver_type + " is not available."));
+  }
+
+  // Monolithic matrix with the given pattern and symbolic factorization.
+  void
+  initialize(const TrilinosWrappers::SparsityPattern &sparsity,
+             const IndexSet &locally_owned_dofs,
+             const MPI_Comm &mpi_communicator)
+  {
+    solver.reset();
+    matrix.reinit(sparsity);
+    solution.reinit(locally_owned_dofs, mpi_communicator);
+    rhs.reinit(locally_owned_dofs, mpi_communicator);
+
+    linear_problem = std::make_unique<Epetra_LinearProblem>(
+        const_cast<Epetra_CrsMatrix *>(&matrix.trilinos_matrix()),
+        &solution.trilinos_vector(),
+        &rhs.trilinos_vector());
+
+    Amesos factory;
+    solver.reset(factory.Create(solver_type, *linear_problem));
+    AssertThrow(solver, ExcMessage("Unable to create the Amesos solver " + solver_type));
+
+    const int ierr = solver->SymbolicFactorization();
+    AssertThrow(ierr == 0, ExcTrilinosError(ierr));
+  }
+
+  bool
+  is_initialized() const
+  {
+    return solver != nullptr;
+  }
+
+  // Copy the values of the blocks and refactorize them.
+  void
+  factorize(const TrilinosWrappers::BlockSparseMatrix &A)
+  {
+    AssertThrow(is_initialized(),
+                ExcMessage("The direct solver must be initialized in setup()."));
+
+    Epetra_CrsMatrix &monolithic = const_cast<Epetra_CrsMatrix &>(matrix.trilinos_matrix());
+    std::vector<int> global_columns;
+
+    for (unsigned int bi = 0; bi < A.n_block_rows(); ++bi)
+      for (unsigned int bj = 0; bj < A.n_block_cols(); ++bj)
+      {
+        const Epetra_CrsMatrix &block = A.block(bi, bj).trilinos_matrix();
+        const int row_start = A.get_row_indices().block_start(bi);
+        const int column_start = A.get_column_indices().block_start(bj);
+
+        for (int row = 0; row < block.NumMyRows(); ++row)
+        {
+          int n_entries;
+          double *values;
+          int *indices;
+          block.ExtractMyRowView(row, n_entries, values, indices);
+          if (n_entries == 0)
+            continue;
+
+          global_columns.resize(n_entries);
+          for (int k = 0; k < n_entries; ++k)
+            global_columns[k] = block.GCID(indices[k]) + column_start;
+
+          // A positive code flags entries missing in the monolithic pattern:
+          // only structural zeros (the diagonal of the pressure block) can be.
+          const int ierr = monolithic.ReplaceGlobalValues(block.GRID(row) + row_start,
+                                                          n_entries,
+                                                          values,
+                                                          global_columns.data());
+          AssertThrow(ierr >= 0, ExcTrilinosError(ierr));
+        }
+      }
+
+    const int ierr = solver->NumericFactorization();
+    AssertThrow(ierr == 0, ExcTrilinosError(ierr));
+  }
+
+  // Solve with the last factorization. The locally owned entries of a block
+  // vector are those of the monolithic one, block after block.
+  void
+  solve(TrilinosWrappers::MPI::BlockVector &x,
+        const TrilinosWrappers::MPI::BlockVector &b)
+  {
+    copy_from_blocks(b, rhs.trilinos_vector()[0]);
+
+    const int ierr = solver->Solve();
+    AssertThrow(ierr == 0, ExcTrilinosError(ierr));
+
+    copy_to_blocks(solution.trilinos_vector()[0], x);
+  }
+
+  // Solve for several right-hand sides at once with the last
+  // factorization: the triangular solves run on a multivector, one column
+  // per right-hand side.
+  void
+  solve(const std::vector<TrilinosWrappers::MPI::BlockVector *> &x,
+        const std::vector<const TrilinosWrappers::MPI::BlockVector *> &b)
+  {
+    AssertDimension(x.size(), b.size());
+
+    const Epetra_BlockMap &map = rhs.trilinos_vector().Map();
+    Epetra_MultiVector rhs_columns(map, b.size());
+    Epetra_MultiVector solution_columns(map, x.size());
+    for (unsigned int k = 0; k < b.size(); ++k)
+      copy_from_blocks(*b[k], rhs_columns[k]);
+
+    linear_problem->SetRHS(&rhs_columns);
+    linear_problem->SetLHS(&solution_columns);
+    const int ierr = solver->Solve();
+    linear_problem->SetRHS(&rhs.trilinos_vector());
+    linear_problem->SetLHS(&solution.trilinos_vector());
+    AssertThrow(ierr == 0, ExcTrilinosError(ierr));
+
+    for (unsigned int k = 0; k < x.size(); ++k)
+      copy_to_blocks(solution_columns[k], *x[k]);
+  }
+
+  const std::string &
+  type() const
+  {
+    return solver_type;
+  }
+
+protected:
+  static void
+  copy_from_blocks(const TrilinosWrappers::MPI::BlockVector &src, double *dst)
+  {
+    for (unsigned int block = 0; block < src.n_blocks(); ++block)
+    {
+      const Epetra_MultiVector &src_epetra = src.block(block).trilinos_vector();
+      dst = std::copy(src_epetra[0], src_epetra[0] + src_epetra.MyLength(), dst);
+    }
+  }
+
+  static void
+  copy_to_blocks(const double *src, TrilinosWrappers::MPI::BlockVector &dst)
+  {
+    for (unsigned int block = 0; block < dst.n_blocks(); ++block)
+    {
+      Epetra_MultiVector &dst_epetra = dst.block(block).trilinos_vector();
+      std::copy(src, src + dst_epetra.MyLength(), dst_epetra[0]);
+      src += dst_epetra.MyLength();
+    }
+  }
+
+  const std::string solver_type;
+
+  // Monolithic copy of the block matrix and vectors.
+  TrilinosWrappers::SparseMatrix matrix;
+  TrilinosWrappers::MPI::Vector solution;
+  TrilinosWrappers::MPI::Vector rhs;
+
+  std::unique_ptr<Epetra_LinearProblem> linear_problem;
+  std::unique_ptr<Amesos_BaseSolver> solver;
+};
+
+#endif
@@ -0,0 +1,2280 @@
+#include "../include/NavierStokes.hpp"
+
+template <int dim>
+void NavierStokes<dim>::setup()
+{
+  // The diagonal blocks of F are no longer the same scalar operator with the
+  // grad-div term.
+  AssertThrow(!(component_preconditioner && grad_div > 0.),
+              ExcMessage("The component-wise preconditioner of F cannot be used with the grad-div term."));
+  // The Schur complement of the augmented Lagrangian preconditioner is the
+  // scaled pressure mass matrix, which does not account for the PSPG block.
+  AssertThrow(!(stabilization && preconditioner_type == 4),
+              ExcMessage("The augmented Lagrangian preconditioner cannot be used with the stabilization."));
+
+  // Create the mesh.
+  {
+    pcout << "Initializing the mesh" << std::endl;
+
+    if (hex_mesh)
+    {
+      // Hexahedral mesh of the problem, partitioned (and repartitioned after
+      // each adaptation) by p4est.
+      auto mesh_hex = std::make_unique<parallel::distributed::Triangulation<dim>>(
+          mpi_communicator,
+          typename Triangulation<dim>::MeshSmoothing(
+              Triangulation<dim>::smoothing_on_refinement |
+              Triangulation<dim>::smoothing_on_coarsening));
+      problem.make_hex_mesh(*mesh_hex);
+      mesh_hex->refine_global(n_hex_refinements);
+      mesh = std::move(mesh_hex);
+    }
+    else
+    {
+      Triangulation<dim> mesh_serial;
+
+      GridIn<dim> grid_in;
+      grid_in.attach_triangulation(mesh_serial);
+
+      std::ifstream grid_in_file(mesh_file_name);
+      grid_in.read_msh(grid_in_file);
+
+      GridTools::partition_triangulation(mpi_size, mesh_serial);
+      const auto construction_data = TriangulationDescription::Utilities::
+          create_description_from_triangulation(mesh_serial, mpi_communicator);
+      auto mesh_simplex = std::make_unique<parallel::fullydistributed::Triangulation<dim>>(mpi_communicator);
+      mesh_simplex->create_triangulation(construction_data);
+      mesh = std::move(mesh_simplex);
+    }
+
+    pcout << "  Number of elements = " << mesh->n_global_active_cells()
+          << std::endl;
+  }
+
+  pcout << "-----------------------------------------------" << std::endl;
+
+  // Initialize the finite element space.
+  {
+    pcout << "Initializing the finite element space" << std::endl;
+
+    std::unique_ptr<FiniteElement<dim>> fe_scalar_velocity;
+    std::unique_ptr<FiniteElement<dim>> fe_scalar_pressure;
+    if (hex_mesh)
+    {
+      fe_scalar_velocity = std::make_unique<FE_Q<dim>>(degree_velocity);
+      fe_scalar_pressure = std::make_unique<FE_Q<dim>>(degree_pressure);
+    }
+    else
+    {
+      fe_scalar_velocity = std::make_unique<FE_SimplexP<dim>>(degree_velocity);
+      fe_scalar_pressure = std::make_unique<FE_SimplexP<dim>>(degree_pressure);
+    }
+    fe = std::make_unique<FESystem<dim>>(*fe_scalar_velocity,
+                                         dim,
+                                         *fe_scalar_pressure,
+                                         1);
+
+    pcout << "  Velocity degree:           = " << fe_scalar_velocity->degree
+          << std::endl;
+    pcout << "  Pressure degree:           = " << fe_scalar_pressure->degree
+          << std::endl;
+    pcout << "  DoFs per cell              = " << fe->dofs_per_cell
+          << std::endl;
+    pcout << "  Assembly kernel            = "
+          << (cell_assembler.is_specialized() ? "specialized" : "generic")
+          << std::endl;
+
+    if (hex_mesh)
+      quadrature = std::make_unique<QGauss<dim>>(fe->degree + 1);
+    else
+      quadrature = std::make_unique<QGaussSimplex<dim>>(fe->degree + 1);
+
+    pcout << "  Quadrature points per cell = " << quadrature->size()
+          << std::endl;
+
+    if (hex_mesh)
+      quadrature_boundary = std::make_unique<QGauss<dim - 1>>(fe->degree + 1);
+    else
+      quadrature_boundary = std::make_unique<QGaussSimplex<dim - 1>>(fe->degree + 1);
+
+    pcout << "  Quadrature points per boundary cell = " << quadrature_boundary->size()
+          << std::endl;
+  }
+
+  pcout << "-----------------------------------------------" << std::endl;
+
+  setup_system();
+
+  // Create the output directory.
+  if (mpi_rank == 0)
+    std::filesystem::create_directories(problem.output_directory());
+}
+
+// Function used to set up the DoFs, the constraints and the linear system on
+// the current mesh
+template <int dim>
+void NavierStokes<dim>::setup_system()
+{
+  // Initialize the DoF handler.
+  {
+    pcout << "Initializing the DoF handler" << std::endl;
+
+    dof_handler.reinit(*mesh);
+    dof_handler.distribute_dofs(*fe);
+
+    // We want to reorder DoFs so that all velocity DoFs come first, and then
+    // all pressure DoFs.
+    std::vector<unsigned int> block_component(dim + 1, 0);
+    block_component[dim] = 1;
+    DoFRenumbering::component_wise(dof_handler, block_component);
+
+    locally_owned_dofs = dof_handler.locally_owned_dofs();
+    DoFTools::extract_locally_relevant_dofs(dof_handler, locally_relevant_dofs);
+
+    // Besides the locally owned and locally relevant indices for the whole
+    // system (velocity and pressure), we will also need those for the
+    // individual velocity and pressure blocks.
+    std::vector<types::global_dof_index> dofs_per_block =
+        DoFTools::count_dofs_per_fe_block(dof_handler, block_component);
+    const unsigned int n_u = dofs_per_block[0];
+    const unsigned int n_p = dofs_per_block[1];
+
+    block_owned_dofs.resize(2);
+    block_relevant_dofs.resize(2);
+    block_owned_dofs[0] = locally_owned_dofs.get_view(0, n_u);
+    block_owned_dofs[1] = locally_owned_dofs.get_view(n_u, n_u + n_p);
+    block_relevant_dofs[0] = locally_relevant_dofs.get_view(0, n_u);
+    block_relevant_dofs[1] = locally_relevant_dofs.get_view(n_u, n_u + n_p);
+
+    pcout << "  Number of DoFs: " << std::endl;
+    pcout << "    velocity = " << n_u << std::endl;
+    pcout << "    pressure = " << n_p << std::endl;
+    pcout << "    total    = " << n_u + n_p << std::endl;
+  }
+
+  // Layout of the velocity components: the DoFs of the components at the
+  // same node, from the local DoFs of the cells with the same base index.
+  if (component_preconditioner)
+  {
+    const IndexSet &velocity_owned = block_owned_dofs[0];
+    std::set<types::global_dof_index> relevant_nodes;
+    std::map<types::global_dof_index, std::array<types::global_dof_index, dim>> nodes;
+    std::vector<types::global_dof_index> dof_indices(fe->dofs_per_cell);
+
+    for (const auto &cell : dof_handler.active_cell_iterators())
+    {
+      if (cell->is_artificial())
+        continue;
+
+      cell->get_dof_indices(dof_indices);
+      for (unsigned int i = 0; i < fe->dofs_per_cell; ++i)
+      {
+        const auto [component, base_index] = fe->system_to_component_index(i);
+        if (component != 0)
+          continue;
+
+        relevant_nodes.insert(dof_indices[i]);
+        if (velocity_owned.is_element(dof_indices[i]))
+          for (unsigned int d = 0; d < dim; ++d)
+            nodes[dof_indices[i]][d] = dof_indices[fe->component_to_system_index(d, base_index)];
+      }
+    }
+
+    // Compact numbering of the nodes: each process numbers its own nodes
+    // after those of the processes of lower rank.
+    const types::global_dof_index n_local_nodes = nodes.size();
+    types::global_dof_index first_node = 0;
+    MPI_Exscan(&n_local_nodes, &first_node, 1, DEAL_II_DOF_INDEX_MPI_TYPE, MPI_SUM,
+               mpi_communicator);
+    if (mpi_rank == 0)
+      first_node = 0;
+    const types::global_dof_index n_nodes = Utilities::MPI::sum(n_local_nodes, mpi_communicator);
+
+    IndexSet scalar_owned(n_nodes);
+    scalar_owned.add_range(first_node, first_node + n_local_nodes);
+    scalar_owned.compress();
+
+    // The numbers of the nodes of the other processes are taken from a
+    // ghosted vector of the velocity block (exact in double precision).
+    TrilinosWrappers::MPI::Vector node_numbers(velocity_owned, mpi_communicator);
+    velocity_components.rows.assign(dim, std::vector<unsigned int>());
+    types::global_dof_index node_number = first_node;
+    for (const auto &[dof, node] : nodes)
+    {
+      node_numbers[dof] = node_number++;
+      for (unsigned int d = 0; d < dim; ++d)
+      {
+        Assert(velocity_owned.is_element(node[d]),
+               ExcMessage("The components of a node must have the same owner."));
+        velocity_components.rows[d].push_back(velocity_owned.index_within_set(node[d]));
+      }
+    }
+    node_numbers.compress(VectorOperation::insert);
+    TrilinosWrappers::MPI::Vector relevant_node_numbers(velocity_owned, block_relevant_dofs[0],
+                                                        mpi_communicator);
+    relevant_node_numbers = node_numbers;
+
+    velocity_components.scalar_columns.clear();
+    for (const types::global_dof_index dof : relevant_nodes)
+      velocity_components.scalar_columns[dof] =
+          static_cast<types::global_dof_index>(relevant_node_numbers[dof]);
+
+    velocity_components.scalar_owned_dofs = scalar_owned;
+    velocity_components.mpi_communicator = mpi_communicator;
+  }
+
+  pcout << "-----------------------------------------------" << std::endl;
+
+  // Initialize the constraints.
+  {
+    pcout << "Initializing the constraints" << std::endl;
+
+    static_constraints.clear();
+    static_constraints.reinit(locally_relevant_dofs);
+    DoFTools::make_hanging_node_constraints(dof_handler, static_constraints);
+    // The periodic neighbours of the locally owned cells must be available
+    // on this process (ghost cells of the partition).
+    for (const auto &[first_id, second_id, direction] : problem.periodic_boundaries())
+      DoFTools::make_periodicity_constraints(dof_handler, first_id, second_id,
+                                             direction, static_constraints);
+    static_constraints.close();
+
+    setup_dirichlet_profiles();
+    update_constraints();
+
+    pcout << "  Constrained DoFs (this process) = " << constraints.n_constraints()
+          << std::endl;
+  }
+
+  pcout << "-----------------------------------------------" << std::endl;
+
+  // Initialize the linear system.
+  {
+    pcout << "Initializing the linear system" << std::endl;
+
+    pcout << "  Initializing the sparsity pattern" << std::endl;
+
+    // Velocity DoFs interact with other velocity DoFs (the weak formulation has
+    // terms involving u times v), and pressure DoFs interact with velocity DoFs
+    // (there are terms involving p times v or u times q). However, pressure
+    // DoFs do not interact with other pressure DoFs (there are no terms
+    // involving p times q), except through the PSPG stabilization. We build a
+    // table to store this information, so that the sparsity pattern can be
+    // built accordingly.
+    Table<2, DoFTools::Coupling> coupling(dim + 1, dim + 1);
+    for (unsigned int c = 0; c < dim + 1; ++c)
+    {
+      for (unsigned int d = 0; d < dim + 1; ++d)
+      {
+        if (c == dim && d == dim) // pressure-pressure term
+          coupling[c][d] = stabilization ? DoFTools::always : DoFTools::none;
+        else // other combinations
+          coupling[c][d] = DoFTools::always;
+      }
+    }
+
+    // Constraints may couple to DoFs of other processes, hence the writable
+    // (locally relevant) rows.
+    TrilinosWrappers::BlockSparsityPattern sparsity(block_owned_dofs,
+                                                    block_owned_dofs,
+                                                    block_relevant_dofs,
+                                                    mpi_communicator);
+    // The constrained rows and columns are eliminated during the assembly,
+    // only their diagonal entry is kept.
+    DoFTools::make_sparsity_pattern(dof_handler, coupling, sparsity, constraints, false);
+    sparsity.compress();
+
+    // Monolithic pattern of the sparse direct solver, with the same
+    // couplings. The pattern does not change, so the symbolic factorization
+    // is done here once.
+    if (direct_solver)
+    {
+      TrilinosWrappers::SparsityPattern direct_sparsity(locally_owned_dofs,
+                                                        locally_owned_dofs,
+                                                        locally_relevant_dofs,
+                                                        mpi_communicator);
+      DoFTools::make_sparsity_pattern(dof_handler, coupling, direct_sparsity, constraints, false);
+      direct_sparsity.compress();
+
+      pcout << "  Symbolic factorization (" << direct_solver->type() << ")" << std::endl;
+      direct_solver->initialize(direct_sparsity, locally_owned_dofs, mpi_communicator);
+    }
+
+    // We also build a sparsity pattern for the pressure mass matrix.
+    for (unsigned int c = 0; c < dim + 1; ++c)
+    {
+      for (unsigned int d = 0; d < dim + 1; ++d)
+      {
+        if (c == dim && d == dim) // pressure-pressure term
+          coupling[c][d] = DoFTools::always;
+        else // other combinations
+          coupling[c][d] = DoFTools::none;
+      }
+    }
+    TrilinosWrappers::BlockSparsityPattern sparsity_pressure_mass(
+        block_owned_dofs, mpi_communicator);
+    DoFTools::make_sparsity_pattern(dof_handler,
+                                    coupling,
+                                    sparsity_pressure_mass);
+    sparsity_pressure_mass.compress();
+
+    pcout << "  Initializing the matrices" << std::endl;
+    system_matrix.reinit(sparsity);
+    mass_matrix.reinit(sparsity);
+    convection_matrix.reinit(sparsity);
+    stiffness_matrix.reinit(sparsity);
+    pressure_mass.reinit(sparsity_pressure_mass);
+
+    pcout << "  Initializing the system right-hand side" << std::endl;
+    system_rhs.reinit(block_owned_dofs, mpi_communicator);
+    pcout << "  Initializing the solution vector" << std::endl;
+    solution_owned.reinit(block_owned_dofs, mpi_communicator);
+
+    // Vectors with ghost elements. With shared memory ghosts, the processes
+    // of a node are grouped in comm_sm.
+    if (shared_memory_ghosts && comm_sm == MPI_COMM_SELF)
+      MPI_Comm_split_type(mpi_communicator, MPI_COMM_TYPE_SHARED, mpi_rank,
+                          MPI_INFO_NULL, &comm_sm);
+    solution.reinit(block_owned_dofs.size());
+    previous_solution.reinit(block_owned_dofs.size());
+    for (unsigned int block = 0; block < block_owned_dofs.size(); ++block)
+    {
+      const auto partitioner = std::make_shared<const Utilities::MPI::Partitioner>(
+          block_owned_dofs[block], block_relevant_dofs[block], mpi_communicator);
+      solution.block(block).reinit(partitioner, comm_sm);
+      previous_solution.block(block).reinit(partitioner, comm_sm);
+    }
+    solution.collect_sizes();
+    previous_solution.collect_sizes();
+    old_solution_owned.reinit(block_owned_dofs, mpi_communicator);
+    outer_residual.reinit(block_owned_dofs, mpi_communicator);
+
+    for (EnsembleMember &member : ensemble)
+    {
+      member.system_rhs.reinit(block_owned_dofs, mpi_communicator);
+      member.solution_owned.reinit(block_owned_dofs, mpi_communicator);
+      member.solution.reinit(solution);
+    }
+  }
+
+  if (matrix_free_operator)
+  {
+    pcout << "  Initializing the matrix-free operator" << std::endl;
+    matrix_free_operator->reinit(dof_handler, constraints, nu, deltat, grad_div);
+    matrix_free_current = false;
+
+    velocity_local_dofs.clear();
+    for (unsigned int i = 0; i < fe->dofs_per_cell; ++i)
+      if (fe->system_to_component_index(i).first < dim)
+        velocity_local_dofs.push_back(i);
+    velocity_dof_indices.resize(velocity_local_dofs.size());
+    cell_velocity_matrix.reinit(velocity_local_dofs.size(), velocity_local_dofs.size());
+  }
+
+  static_matrices_outdated = true;
+}
+
+
+
+
+// Function used to assemble the static Matrixes,
+// mass matrix, the stiffness matrix, the pressure matrix
+template <int dim>
+void NavierStokes<dim>::assemble(const double &time)
+{
+  pcout << "===============================================" << std::endl;
+  pcout << "Assembling the system" << std::endl;
+
+  const unsigned int dofs_per_cell = fe->dofs_per_cell;
+  const unsigned int n_q = quadrature->size();
+  const unsigned int n_q_boundary = quadrature_boundary->size();
+
+  FEValues<dim> fe_values(*fe,
+                          *quadrature,
+                          update_values | update_gradients |
+                              update_quadrature_points | update_JxW_values);
+  FEFaceValues<dim> fe_boundary_values(*fe,
+                                       *quadrature_boundary,
+                                       update_values | update_quadrature_points |
+                                           update_normal_vectors |
+                                           update_JxW_values);
+
+  FullMatrix<double> cell_matrix(dofs_per_cell, dofs_per_cell);
+  FullMatrix<double> cell_mass_matrix(dofs_per_cell, dofs_per_cell);
+  FullMatrix<double> cell_stiffness_matrix(dofs_per_cell, dofs_per_cell);
+  FullMatrix<double> cell_convection_matrix(dofs_per_cell, dofs_per_cell);
+  FullMatrix<double> cell_pressure_mass_matrix(dofs_per_cell, dofs_per_cell);
+  Vector<double> cell_rhs(dofs_per_cell);
+
+  std::vector<types::global_dof_index> dof_indices(dofs_per_cell);
+
+  system_matrix = 0.0;
+  mass_matrix = 0.0;
+  stiffness_matrix = 0.0;
+  convection_matrix = 0.0;
+  system_rhs = 0.0;
+  pressure_mass = 0.0;
+  constrained_cell_matrices.clear();
+  constrained_cell_mass_matrices.clear();
+
+  problem.set_time(time);
+  update_constraints();
+
+  FEValuesExtractors::Vector velocity(0);
+  FEValuesExtractors::Scalar pressure(dim);
+
+  const Function<dim> &forcing_term = problem.forcing_term();
+  const Function<dim> &function_h = problem.neumann_function();
+  const std::set<types::boundary_id> neumann_ids = problem.neumann_boundary_ids();
+  Vector<double> forcing_term_loc(forcing_term.n_components);
+  Vector<double> neumann_loc(function_h.n_components);
+
+  // Store the current velocity value
+  std::vector<Tensor<1, dim>> current_velocity_values(n_q);
+  // Store the current velocity divergence value
+  std::vector<double> current_velocity_divergence(n_q);
+  // Store the forcing term value
+  std::vector<Tensor<1, dim>> forcing_values(n_q);
+
+  for (const auto &cell : dof_handler.active_cell_iterators())
+  {
+
+    if (!cell->is_locally_owned())
+      continue;
+
+    fe_values.reinit(cell);
+
+    cell_matrix = 0.0;
+    cell_mass_matrix = 0.0;
+    cell_stiffness_matrix = 0.0;
+    cell_convection_matrix = 0.0;
+    cell_rhs = 0.0;
+    cell_pressure_mass_matrix = 0.0;
+
+    // Retrieve the current solution values.
+    fe_values[velocity].get_function_values(solution, current_velocity_values);
+    // Retrieve the current solution divergence values
+    fe_values[velocity].get_function_divergences(solution, current_velocity_divergence);
+
+    for (unsigned int q = 0; q < n_q; ++q)
+    {
+      forcing_term.vector_value(fe_values.quadrature_point(q),
+                                forcing_term_loc);
+      for (unsigned int d = 0; d < dim; ++d)
+        forcing_values[q][d] = forcing_term_loc[d];
+    }
+
+    cell_assembler.assemble_cell(fe_values,
+                                 current_velocity_values,
+                                 current_velocity_divergence,
+                                 forcing_values,
+                                 nu,
+                                 deltat,
+                                 grad_div,
+                                 cell_matrix,
+                                 cell_mass_matrix,
+                                 cell_stiffness_matrix,
+                                 cell_convection_matrix,
+                                 cell_pressure_mass_matrix,
+                                 cell_rhs);
+
+    if (stabilization)
+      StabilizationKernel<dim>::add_cell_terms(fe_values, current_velocity_values,
+                                               current_velocity_values, forcing_values,
+                                               cell->diameter(), nu, deltat, true, supg,
+                                               cell_convection_matrix, cell_rhs);
+
+    // Boundary integral for Neumann BCs.
+    if (cell->at_boundary() && !neumann_ids.empty())
+    {
+      for (unsigned int f = 0; f < cell->n_faces(); ++f)
+      {
+        if (cell->face(f)->at_boundary() &&
+            neumann_ids.count(cell->face(f)->boundary_id()))
+        {
+          fe_boundary_values.reinit(cell, f);
+
+          for (unsigned int q = 0; q < n_q_boundary; ++q)
+          {
+            function_h.vector_value(fe_boundary_values.quadrature_point(q),
+                                    neumann_loc);
+            Tensor<1, dim> neumann_loc_tensor;
+            for (unsigned int d = 0; d < dim; ++d)
+              neumann_loc_tensor[d] = neumann_loc[d];
+
+            for (unsigned int i = 0; i < dofs_per_cell; ++i)
+            {
+              cell_rhs(i) +=
+                  scalar_product(neumann_loc_tensor, fe_boundary_values[velocity].value(i, q)) * fe_boundary_values.JxW(q);
+            }
+          }
+        }
+      }
+    }
+
+    cell->get_dof_indices(dof_indices);
+
+    // The constraints are imposed while the cell matrices are distributed.
+    // The pressure mass matrix only enters the preconditioners, it is added
+    // as it is.
+    constraints.distribute_local_to_global(cell_matrix, dof_indices, system_matrix);
+    constraints.distribute_local_to_global(cell_mass_matrix, dof_indices, mass_matrix);
+    distribute_cell_convection(cell_convection_matrix, dof_indices);
+    constraints.distribute_local_to_global(cell_stiffness_matrix, dof_indices, stiffness_matrix);
+    pressure_mass.add(dof_indices, cell_pressure_mass_matrix);
+
+    // The static part of the cell matrix is kept for the lifting of the
+    // Dirichlet data at the following steps.
+    if (std::any_of(dof_indices.begin(), dof_indices.end(),
+                    [&](const types::global_dof_index &i) { return constraints.is_constrained(i); }))
+    {
+      FullMatrix<double> &static_matrix = constrained_cell_matrices[cell->active_cell_index()];
+      static_matrix = cell_matrix;
+      static_matrix.add(1., cell_stiffness_matrix);
+      constrained_cell_mass_matrices[cell->active_cell_index()] = cell_mass_matrix;
+    }
+    distribute_cell_rhs(cell, dof_indices, cell_rhs, cell_convection_matrix, true, cell_matrix);
+  }
+
+  system_matrix.compress(VectorOperation::add);
+  mass_matrix.compress(VectorOperation::add);
+  convection_matrix.compress(VectorOperation::add);
+  stiffness_matrix.compress(VectorOperation::add);
+  system_rhs.compress(VectorOperation::add);
+  pressure_mass.compress(VectorOperation::add);
+
+  // The velocity mass matrix does not change: its diagonal data used by the
+  // preconditioners are computed here once.
+  operator_diagonals.initialize_mass(mass_matrix.block(0, 0));
+  static_matrices_outdated = false;
+
+  // Create the System Matrix F = M + A + C(u_n) + B
+  system_matrix.add(1., mass_matrix);
+  add_convection_to_system(1.);
+  system_matrix.add(1., stiffness_matrix);
+
+  // Boundary values on the initial guess of the solve.
+  constraints.distribute(solution_owned);
+  update_matrix_free_operator(true, false);
+}
+
+// Function used to assemble at time > deltat to avoid redundant computation of A,M,B
+// assemble rhs and convection matrix (only the convection matrix if with_rhs
+// is false, for the ensemble whose members assemble their own rhs)
+template <int dim>
+void NavierStokes<dim>::assemble_time_step(const double &time, const bool &with_rhs)
+{
+  pcout << "===============================================" << std::endl;
+  pcout << "Assembling the system" << std::endl;
+
+  const unsigned int dofs_per_cell = fe->dofs_per_cell;
+  const unsigned int n_q = quadrature->size();
+  const unsigned int n_q_boundary = quadrature_boundary->size();
+
+  FEValues<dim> fe_values(*fe,
+                          *quadrature,
+                          update_values | update_gradients |
+                              update_quadrature_points | update_JxW_values);
+  FEFaceValues<dim> fe_boundary_values(*fe,
+                                       *quadrature_boundary,
+                                       update_values | update_quadrature_points |
+                                           update_normal_vectors |
+                                           update_JxW_values);
+
+
+  // With a specialized kernel the cells are assembled in batches, one cell per
+  // SIMD lane: each lane keeps its own local matrix, vector and DoF indices
+  // until the batch is full. The stabilization terms are assembled cell by
+  // cell.
+  const bool batched = cell_assembler.is_specialized() && !stabilization;
+  const unsigned int n_lanes = batched ? cell_assembler.n_batch_lanes() : 1;
+  CellBatch<dim> batch;
+  if (batched)
+    batch.reinit(dofs_per_cell, n_q);
+
+  std::vector<FullMatrix<double>> cell_convection_matrices(
+      n_lanes, FullMatrix<double>(dofs_per_cell, dofs_per_cell));
+  std::vector<Vector<double>> cell_rhs_lanes(n_lanes, Vector<double>(dofs_per_cell));
+  std::vector<std::vector<types::global_dof_index>> dof_indices(
+      n_lanes, std::vector<types::global_dof_index>(dofs_per_cell));
+  std::vector<typename DoFHandler<dim>::active_cell_iterator> lane_cells(n_lanes);
+  FullMatrix<double> cell_matrix(dofs_per_cell, dofs_per_cell);
+  unsigned int lane = 0;
+
+  // Assemble the volume terms of the batch and add the local contributions
+  // of its first n_filled lanes to the global system.
+  const auto distribute_batch = [&](const unsigned int &n_filled) {
+    if (batched)
+      cell_assembler.assemble_batch_convection(batch, n_filled, deltat,
+                                               cell_convection_matrices,
+                                               cell_rhs_lanes);
+
+    for (unsigned int l = 0; l < n_filled; ++l)
+    {
+      distribute_cell_convection(cell_convection_matrices[l], dof_indices[l]);
+      if (with_rhs)
+        distribute_cell_rhs(lane_cells[l], dof_indices[l], cell_rhs_lanes[l],
+                            cell_convection_matrices[l], true, cell_matrix);
+    }
+  };
+
+  // We delete the previous Convection Matrix from the system matrix
+  add_convection_to_system(-1.);
+  convection_matrix = 0.0;
+  if (with_rhs)
+    system_rhs = 0.0;
+
+  problem.set_time(time);
+  update_constraints();
+
+  FEValuesExtractors::Vector velocity(0);
+  FEValuesExtractors::Scalar pressure(dim);
+
+  const Function<dim> &forcing_term = problem.forcing_term();
+  const Function<dim> &function_h = problem.neumann_function();
+  const std::set<types::boundary_id> neumann_ids = problem.neumann_boundary_ids();
+  const std::set<types::boundary_id> backflow_ids = problem.backflow_boundary_ids();
+  Vector<double> forcing_term_loc(forcing_term.n_components);
+  Vector<double> neumann_loc(function_h.n_components);
+
+  std::vector<Tensor<1, dim>> boundary_velocity_values(n_q_boundary);
+  std::vector<Tensor<1, dim>> prev_boundary_velocity_values(n_q_boundary);
+
+  // Store the current velocity value in a tensor
+  std::vector<Tensor<1, dim>> current_velocity_values(n_q);
+  // Store the current velocity divergence value in a tensor
+  std::vector<double> current_velocity_divergence(n_q);
+  // Store the forcing term value in a tensor
+  std::vector<Tensor<1, dim>> forcing_values(n_q);
+
+  for (const auto &cell : dof_handler.active_cell_iterators())
+  {
+    if (!cell->is_locally_owned())
+      continue;
+
+    fe_values.reinit(cell);
+
+    FullMatrix<double> &cell_convection_matrix = cell_convection_matrices[lane];
+    Vector<double> &cell_rhs = cell_rhs_lanes[lane];
+    cell_convection_matrix = 0.0;
+    cell_rhs = 0.0;
+
+    // Retrieve the current solution values.
+    fe_values[velocity].get_function_values(solution, current_velocity_values);
+    // Retrieve the current solution divergence values
+    fe_values[velocity].get_function_divergences(solution, current_velocity_divergence);
+
+    // Without the rhs the forcing term is left to zero.
+    if (with_rhs)
+      for (unsigned int q = 0; q < n_q; ++q)
+      {
+        forcing_term.vector_value(fe_values.quadrature_point(q),
+                                  forcing_term_loc);
+        for (unsigned int d = 0; d < dim; ++d)
+          forcing_values[q][d] = forcing_term_loc[d];
+      }
+
+    // Volume terms: either deferred to the batch or assembled right away.
+    if (batched)
+      batch.fill_lane(fe_values, lane, current_velocity_values,
+                      current_velocity_divergence, forcing_values);
+    else
+    {
+      cell_assembler.assemble_cell_convection(fe_values,
+                                              current_velocity_values,
+                                              current_velocity_divergence,
+                                              forcing_values,
+                                              deltat,
+                                              cell_convection_matrix,
+                                              cell_rhs);
+      if (stabilization)
+        StabilizationKernel<dim>::add_cell_terms(fe_values, current_velocity_values,
+                                                 current_velocity_values, forcing_values,
+                                                 cell->diameter(), nu, deltat, true, supg,
+                                                 cell_convection_matrix, cell_rhs);
+    }
+
+    if (cell->at_boundary())
+    {
+      for (unsigned int f = 0; f < cell->n_faces(); ++f)
+      {
+        if (!cell->face(f)->at_boundary())
+          continue;
+
+        const types::boundary_id boundary_id = cell->face(f)->boundary_id();
+
+        // Boundary integral for Neumann BCs.
+        if (with_rhs && neumann_ids.count(boundary_id))
+        {
+          fe_boundary_values.reinit(cell, f);
+
+          for (unsigned int q = 0; q < n_q_boundary; ++q)
+          {
+            function_h.vector_value(fe_boundary_values.quadrature_point(q),
+                                    neumann_loc);
+            Tensor<1, dim> neumann_loc_tensor;
+            for (unsigned int d = 0; d < dim; ++d)
+              neumann_loc_tensor[d] = neumann_loc[d];
+
+            for (unsigned int i = 0; i < dofs_per_cell; ++i)
+            {
+              cell_rhs(i) +=
+                  scalar_product(neumann_loc_tensor,
+                                 fe_boundary_values[velocity].value(i, q)) *
+                  fe_boundary_values.JxW(q);
+            }
+          }
+        }
+
+        // BackFlow Stabilization on open boundary ( only for 3D instabilities for high Re and coarse meshes )
+        if (backflow_ids.count(boundary_id))
+        {
+          fe_boundary_values.reinit(cell, f);
+          fe_boundary_values[velocity].get_function_values(solution, boundary_velocity_values);
+          fe_boundary_values[velocity].get_function_values(previous_solution, prev_boundary_velocity_values);
+
+          for (unsigned int q = 0; q < n_q_boundary; ++q)
+          {
+            for (unsigned int i = 0; i < dofs_per_cell; ++i)
+            {
+              for (unsigned int j = 0; j < dofs_per_cell; ++j)
+              {
+                  cell_convection_matrix(i, j) -= 1.5 * std::min((2. * boundary_velocity_values[q] - prev_boundary_velocity_values[q] )* fe_boundary_values.normal_vector(q), 0.0) *
+                                                        scalar_product(fe_boundary_values[velocity].value(j, q),fe_boundary_values[velocity].value(i, q)) *
+                                                        fe_boundary_values.JxW(q);
+              }
+            }
+          }
+        }
+      }
+    }
+
+    cell->get_dof_indices(dof_indices[lane]);
+    lane_cells[lane] = cell;
+
+    if (++lane == n_lanes)
+    {
+      distribute_batch(n_lanes);
+      lane = 0;
+    }
+  }
+  // Last, partially filled, batch.
+  if (lane > 0)
+    distribute_batch(lane);
+
+  convection_matrix.compress(VectorOperation::add);
+  if (with_rhs)
+    system_rhs.compress(VectorOperation::add);
+  add_convection_to_system(1.);
+
+  // Boundary values on the initial guess of the solve.
+  constraints.distribute(solution_owned);
+  update_matrix_free_operator(true, false);
+}
+
+// Function used to assemble the linearized system of a Picard/Newton iteration:
+// convection matrix C(u_k) (+ N(u_k) for Newton) and right-hand side
+template <int dim>
+void NavierStokes<dim>::assemble_nonlinear_step(const double &time, const bool &newton, const bool &steady)
+{
+  const unsigned int dofs_per_cell = fe->dofs_per_cell;
+  const unsigned int n_q = quadrature->size();
+  const unsigned int n_q_boundary = quadrature_boundary->size();
+
+  FEValues<dim> fe_values(*fe,
+                          *quadrature,
+                          update_values | update_gradients |
+                              update_quadrature_points | update_JxW_values);
+  FEFaceValues<dim> fe_boundary_values(*fe,
+                                       *quadrature_boundary,
+                                       update_values | update_quadrature_points |
+                                           update_normal_vectors |
+                                           update_JxW_values);
+
+  FullMatrix<double> cell_convection_matrix(dofs_per_cell, dofs_per_cell);
+  FullMatrix<double> cell_matrix(dofs_per_cell, dofs_per_cell);
+  Vector<double> cell_rhs(dofs_per_cell);
+
+  std::vector<types::global_dof_index> dof_indices(dofs_per_cell);
+
+  // We delete the previous Convection Matrix from the system matrix
+  add_convection_to_system(-1.);
+  convection_matrix = 0.0;
+  system_rhs = 0.0;
+
+  problem.set_time(time);
+  update_constraints();
+
+  FEValuesExtractors::Vector velocity(0);
+
+  const Function<dim> &forcing_term = problem.forcing_term();
+  const Function<dim> &function_h = problem.neumann_function();
+  const std::set<types::boundary_id> neumann_ids = problem.neumann_boundary_ids();
+  const std::set<types::boundary_id> backflow_ids = problem.backflow_boundary_ids();
+  Vector<double> forcing_term_loc(forcing_term.n_components);
+  Vector<double> neumann_loc(function_h.n_components);
+
+  std::vector<Tensor<1, dim>> boundary_velocity_values(n_q_boundary);
+
+  // Current iterate u_k: values, gradients and divergence
+  std::vector<Tensor<1, dim>> current_velocity_values(n_q);
+  std::vector<Tensor<2, dim>> current_velocity_gradients(n_q);
+  std::vector<double> current_velocity_divergence(n_q);
+  // Velocity at the previous time step u^n
+  std::vector<Tensor<1, dim>> old_velocity_values(n_q);
+  // Forcing term, kept for the stabilization
+  std::vector<Tensor<1, dim>> forcing_values(n_q);
+
+  for (const auto &cell : dof_handler.active_cell_iterators())
+  {
+    if (!cell->is_locally_owned())
+      continue;
+
+    fe_values.reinit(cell);
+
+    cell_convection_matrix = 0.0;
+    cell_rhs = 0.0;
+
+    fe_values[velocity].get_function_values(solution, current_velocity_values);
+    fe_values[velocity].get_function_gradients(solution, current_velocity_gradients);
+    fe_values[velocity].get_function_divergences(solution, current_velocity_divergence);
+    if (!steady)
+      fe_values[velocity].get_function_values(previous_solution, old_velocity_values);
+
+    for (unsigned int q = 0; q < n_q; ++q)
+    {
+      forcing_term.vector_value(fe_values.quadrature_point(q),
+                                forcing_term_loc);
+      Tensor<1, dim> forcing_term_tensor;
+      for (unsigned int d = 0; d < dim; ++d)
+        forcing_term_tensor[d] = forcing_term_loc[d];
+      forcing_values[q] = forcing_term_tensor;
+
+      // (u_k . grad) u_k + 0.5 div(u_k) u_k, i.e. N(u_k) u_k
+      const Tensor<1, dim> newton_rhs =
+          current_velocity_gradients[q] * current_velocity_values[q] +
+          0.5 * current_velocity_divergence[q] * current_velocity_values[q];
+
+      for (unsigned int i = 0; i < dofs_per_cell; ++i)
+      {
+        const Tensor<1, dim> phi_i = fe_values[velocity].value(i, q);
+
+        for (unsigned int j = 0; j < dofs_per_cell; ++j)
+        {
+          const Tensor<1, dim> phi_j = fe_values[velocity].value(j, q);
+
+          // Convective term (u_k . grad) du
+          cell_convection_matrix(i, j) += scalar_product(fe_values[velocity].gradient(j, q) * current_velocity_values[q], phi_i) * fe_values.JxW(q);
+
+          // Temam Stabilization term
+          cell_convection_matrix(i, j) += 0.5 * current_velocity_divergence[q] * scalar_product(phi_i, phi_j) * fe_values.JxW(q);
+
+          if (newton)
+          {
+            // Newton terms (du . grad) u_k + 0.5 div(du) u_k
+            cell_convection_matrix(i, j) += scalar_product(current_velocity_gradients[q] * phi_j, phi_i) * fe_values.JxW(q);
+            cell_convection_matrix(i, j) += 0.5 * fe_values[velocity].divergence(j, q) * scalar_product(current_velocity_values[q], phi_i) * fe_values.JxW(q);
+          }
+        }
+
+        // Time derivative discretization on the right hand side
+        if (!steady)
+          cell_rhs(i) += scalar_product(old_velocity_values[q], phi_i) * fe_values.JxW(q) / deltat;
+
+        // Forcing term.
+        cell_rhs(i) += scalar_product(forcing_term_tensor, phi_i) * fe_values.JxW(q);
+
+        // Newton term of the linearization around u_k
+        if (newton)
+          cell_rhs(i) += scalar_product(newton_rhs, phi_i) * fe_values.JxW(q);
+      }
+    }
+
+    // Stabilization, with the convective velocity u_k also in the Newton
+    // iterations.
+    if (stabilization)
+      StabilizationKernel<dim>::add_cell_terms(fe_values, current_velocity_values,
+                                               old_velocity_values, forcing_values,
+                                               cell->diameter(), nu, deltat, !steady, supg,
+                                               cell_convection_matrix, cell_rhs);
+
+    if (cell->at_boundary())
+    {
+      for (unsigned int f = 0; f < cell->n_faces(); ++f)
+      {
+        if (!cell->face(f)->at_boundary())
+          continue;
+
+        const types::boundary_id boundary_id = cell->face(f)->boundary_id();
+
+        // Boundary integral for Neumann BCs.
+        if (neumann_ids.count(boundary_id))
+        {
+          fe_boundary_values.reinit(cell, f);
+
+          for (unsigned int q = 0; q < n_q_boundary; ++q)
+          {
+            function_h.vector_value(fe_boundary_values.quadrature_point(q),
+                                    neumann_loc);
+            Tensor<1, dim> neumann_loc_tensor;
+            for (unsigned int d = 0; d < dim; ++d)
+              neumann_loc_tensor[d] = neumann_loc[d];
+
+            for (unsigned int i = 0; i < dofs_per_cell; ++i)
+            {
+              cell_rhs(i) +=
+                  scalar_product(neumann_loc_tensor,
+                                 fe_boundary_values[velocity].value(i, q)) *
+                  fe_boundary_values.JxW(q);
+            }
+          }
+        }
+
+        // BackFlow Stabilization, linearized around the current iterate
+        if (backflow_ids.count(boundary_id))
+        {
+          fe_boundary_values.reinit(cell, f);
+          fe_boundary_values[velocity].get_function_values(solution, boundary_velocity_values);
+
+          for (unsigned int q = 0; q < n_q_boundary; ++q)
+          {
+            for (unsigned int i = 0; i < dofs_per_cell; ++i)
+            {
+              for (unsigned int j = 0; j < dofs_per_cell; ++j)
+              {
+                  cell_convection_matrix(i, j) -= 1.5 * std::min(boundary_velocity_values[q] * fe_boundary_values.normal_vector(q), 0.0) *
+                                                        scalar_product(fe_boundary_values[velocity].value(j, q),fe_boundary_values[velocity].value(i, q)) *
+                                                        fe_boundary_values.JxW(q);
+              }
+            }
+          }
+        }
+      }
+    }
+
+    cell->get_dof_indices(dof_indices);
+    distribute_cell_convection(cell_convection_matrix, dof_indices);
+    // In the steady problem the mass matrix has been removed from the system.
+    distribute_cell_rhs(cell, dof_indices, cell_rhs, cell_convection_matrix, !steady, cell_matrix);
+  }
+  convection_matrix.compress(VectorOperation::add);
+  system_rhs.compress(VectorOperation::add);
+  add_convection_to_system(1.);
+
+  // Boundary values on the initial guess of the solve.
+  constraints.distribute(solution_owned);
+  update_matrix_free_operator(!steady, newton);
+}
+
+// Function used to solve the nonlinear problem of one time step (or the steady
+// problem) with Picard iterations followed by Newton iterations. The residual
+// of the nonlinear problem at the iterate u_k is J(u_k) u_k - b(u_k), since the
+// linearized system is written for the new iterate.
+template <int dim>
+void NavierStokes<dim>::solve_nonlinear(const double &time, const bool &steady)
+{
+  // The iterations start from solution_owned (u^n or its extrapolation).
+  if (!steady)
+    previous_solution.swap(solution);
+  copy_to_ghosted(solution_owned, solution);
+
+  TrilinosWrappers::MPI::BlockVector residual(block_owned_dofs, mpi_communicator);
+  double initial_residual_norm = 0.0;
+  bool converged = false;
+
+  for (unsigned int k = 0; k <= max_nonlinear_iterations; ++k)
+  {
+    const bool newton = nonlinear_solver == NonlinearSolver::newton &&
+                        k >= n_picard_iterations;
+
+    assemble_nonlinear_step(time, newton, steady);
+
+    // Boundary values are now imposed on the iterate (solution_owned) as well,
+    // the constrained rows are left out of the residual.
+    system_matrix.vmult(residual, solution_owned);
+    residual -= system_rhs;
+    constraints.set_zero(residual);
+    const double residual_norm = residual.l2_norm();
+    if (k == 0)
+      initial_residual_norm = residual_norm;
+    if (adaptive_tolerance)
+    {
+      if (k == 0)
+        adaptive_tolerance->start_nonlinear_solve();
+      adaptive_tolerance->update_from_nonlinear_residual(residual_norm);
+    }
+
+    pcout << "  Nonlinear iteration " << k << " (" << (newton ? "Newton" : "Picard")
+          << "): residual = " << residual_norm << std::endl;
+
+    if (residual_norm <= nonlinear_tolerance * initial_residual_norm ||
+        residual_norm < 1e-14)
+    {
+      converged = true;
+      break;
+    }
+    if (k == max_nonlinear_iterations)
+      break;
+
+    solve_time_step(time);
+  }
+
+  if (!converged)
+    pcout << "  Warning: nonlinear solver not converged in "
+          << max_nonlinear_iterations << " iterations" << std::endl;
+}
+
+// Function used to solve the steady problem
+template <int dim>
+void NavierStokes<dim>::solve_steady()
+{
+  pcout << "===============================================" << std::endl;
+  pcout << "Solving the steady problem" << std::endl;
+
+  problem.set_time(0.0);
+  solution_owned = 0.0;
+  copy_to_ghosted(solution_owned, solution);
+
+  // Static matrices, then the time derivative is removed from the system.
+  assemble(0.0);
+  system_matrix.add(-1., mass_matrix);
+
+  if (nonlinear_solver == NonlinearSolver::semi_implicit)
+    nonlinear_solver = NonlinearSolver::newton;
+  solve_nonlinear(0.0, true);
+
+  output(1);
+
+  if (problem.obstacle_boundary_id() != numbers::invalid_boundary_id)
+  {
+    compute_forces();
+    compute_pressure_difference();
+  }
+}
+
+// Function used to interpolate the spatial profiles of the Dirichlet data
+template <int dim>
+void NavierStokes<dim>::setup_dirichlet_profiles()
+{
+  dirichlet_dofs.clear();
+  dirichlet_profile.clear();
+
+  const std::vector<typename ProblemDescription<dim>::BoundaryFunctions> profiles =
+      problem.dirichlet_profiles();
+  separable_dirichlet = !profiles.empty();
+  if (!separable_dirichlet)
+    return;
+
+  std::map<types::global_dof_index, double> boundary_values;
+  const ComponentMask velocity_mask =
+      fe->component_mask(FEValuesExtractors::Vector(0));
+  // Groups override each other as in dirichlet_boundaries().
+  for (const auto &boundary_functions : profiles)
+    VectorTools::interpolate_boundary_values(dof_handler,
+                                             boundary_functions,
+                                             boundary_values,
+                                             velocity_mask);
+
+  dirichlet_dofs.reserve(boundary_values.size());
+  dirichlet_profile.reserve(boundary_values.size());
+  for (const auto &[dof, value] : boundary_values)
+  {
+    dirichlet_dofs.push_back(dof);
+    dirichlet_profile.push_back(value);
+  }
+}
+
+// Function used to set up the constraints, the problem data must already be
+// set to the current time. The DoFs already constrained by hanging nodes or
+// periodicity keep those constraints. The set of constrained DoFs does not
+// change, only the inhomogeneities do.
+template <int dim>
+void NavierStokes<dim>::update_constraints()
+{
+  update_constraints(constraints, 1.0);
+}
+
+template <int dim>
+void NavierStokes<dim>::update_constraints(AffineConstraints<double> &target,
+                                           const double &dirichlet_scaling) const
+{
+  target.copy_from(static_constraints);
+
+  const auto add_dirichlet = [&](const types::global_dof_index &dof, const double &value) {
+    if (!target.is_constrained(dof))
+    {
+      target.add_line(dof);
+      target.set_inhomogeneity(dof, dirichlet_scaling * value);
+    }
+  };
+
+  // Separable data: the cached profile is scaled by the time factor.
+  if (separable_dirichlet)
+  {
+    const double time_factor = problem.dirichlet_time_factor();
+    for (unsigned int k = 0; k < dirichlet_dofs.size(); ++k)
+      add_dirichlet(dirichlet_dofs[k], time_factor * dirichlet_profile[k]);
+  }
+  else
+  {
+    std::map<types::global_dof_index, double> boundary_values;
+
+    const ComponentMask velocity_mask =
+        fe->component_mask(FEValuesExtractors::Vector(0));
+
+    // Each group is interpolated after the previous ones, so that it overrides
+    // them on the DoFs they share.
+    for (const auto &boundary_functions : problem.dirichlet_boundaries())
+      VectorTools::interpolate_boundary_values(dof_handler,
+                                               boundary_functions,
+                                               boundary_values,
+                                               velocity_mask);
+
+    for (const auto &[dof, value] : boundary_values)
+      add_dirichlet(dof, value);
+  }
+
+  target.close();
+}
+
+// Function used to add the right-hand side of a cell to the system
+template <int dim>
+void NavierStokes<dim>::distribute_cell_rhs(const typename DoFHandler<dim>::active_cell_iterator &cell,
+                                            const std::vector<types::global_dof_index> &dof_indices,
+                                            const Vector<double> &cell_rhs,
+                                            const FullMatrix<double> &cell_convection_matrix,
+                                            const bool &with_mass,
+                                            FullMatrix<double> &cell_matrix)
+{
+  distribute_cell_rhs(cell, dof_indices, cell_rhs, cell_convection_matrix, with_mass,
+                      cell_matrix, constraints, system_rhs);
+}
+
+template <int dim>
+void NavierStokes<dim>::distribute_cell_rhs(const typename DoFHandler<dim>::active_cell_iterator &cell,
+                                            const std::vector<types::global_dof_index> &dof_indices,
+                                            const Vector<double> &cell_rhs,
+                                            const FullMatrix<double> &cell_convection_matrix,
+                                            const bool &with_mass,
+                                            FullMatrix<double> &cell_matrix,
+                                            const AffineConstraints<double> &cell_constraints,
+                                            TrilinosWrappers::MPI::BlockVector &rhs)
+{
+  const auto static_matrix = constrained_cell_matrices.find(cell->active_cell_index());
+  if (static_matrix == constrained_cell_matrices.end())
+  {
+    cell_constraints.distribute_local_to_global(cell_rhs, dof_indices, rhs);
+    return;
+  }
+
+  cell_matrix = static_matrix->second;
+  if (with_mass)
+    cell_matrix.add(1., constrained_cell_mass_matrices.at(cell->active_cell_index()));
+  cell_matrix.add(1., cell_convection_matrix);
+  cell_constraints.distribute_local_to_global(cell_rhs, dof_indices, rhs, cell_matrix);
+}
+
+// Function used to adapt the mesh: cells are refined and coarsened by the
+// Kelly indicator of the velocity (jumps of its gradient across the faces,
+// large in the shear layers and in the vortices of the wake)
+template <int dim>
+void NavierStokes<dim>::refine_mesh()
+{
+  pcout << "===============================================" << std::endl;
+  pcout << "Adapting the mesh" << std::endl;
+
+  auto &tria = dynamic_cast<parallel::distributed::Triangulation<dim> &>(*mesh);
+
+  // The transfer works on Trilinos vectors of the whole system, built on the
+  // locally owned DoFs (with the component-wise numbering, a velocity and a
+  // pressure range on each process); the entries are moved by global index.
+  const auto to_vector = [&](const LinearAlgebra::distributed::BlockVector<double> &src,
+                             TrilinosWrappers::MPI::Vector &dst) {
+    TrilinosWrappers::MPI::Vector owned(locally_owned_dofs, mpi_communicator);
+    for (const types::global_dof_index dof : locally_owned_dofs)
+      owned[dof] = src(dof);
+    owned.compress(VectorOperation::insert);
+    dst.reinit(locally_owned_dofs, locally_relevant_dofs, mpi_communicator);
+    dst = owned;
+  };
+  const auto from_vector = [&](const TrilinosWrappers::MPI::Vector &src,
+                               LinearAlgebra::distributed::BlockVector<double> &dst) {
+    for (const types::global_dof_index dof : locally_owned_dofs)
+      dst(dof) = src[dof];
+    dst.update_ghost_values();
+  };
+
+  TrilinosWrappers::MPI::Vector current, previous;
+  to_vector(solution, current);
+  to_vector(previous_solution, previous);
+
+  Vector<float> indicators(tria.n_active_cells());
+  KellyErrorEstimator<dim>::estimate(dof_handler,
+                                     QGauss<dim - 1>(fe->degree + 1),
+                                     {},
+                                     current,
+                                     indicators,
+                                     fe->component_mask(FEValuesExtractors::Vector(0)));
+  parallel::distributed::GridRefinement::refine_and_coarsen_fixed_number(
+      tria, indicators,
+      adaptive_refinement->refine_fraction, adaptive_refinement->coarsen_fraction);
+
+  for (const auto &cell : tria.active_cell_iterators())
+    if (cell->is_locally_owned())
+    {
+      if (cell->level() >= static_cast<int>(adaptive_refinement->max_level))
+        cell->clear_refine_flag();
+      if (cell->level() <= static_cast<int>(adaptive_refinement->initial_refinements))
+        cell->clear_coarsen_flag();
+    }
+
+  parallel::distributed::SolutionTransfer<dim, TrilinosWrappers::MPI::Vector>
+      solution_transfer(dof_handler);
+  tria.prepare_coarsening_and_refinement();
+  solution_transfer.prepare_for_coarsening_and_refinement(
+      std::vector<const TrilinosWrappers::MPI::Vector *>{&current, &previous});
+
+  // The cells are repartitioned by the adaptation.
+  tria.execute_coarsening_and_refinement();
+  pcout << "  Number of elements = " << tria.n_global_active_cells() << std::endl;
+
+  setup_system();
+
+  TrilinosWrappers::MPI::Vector new_current(locally_owned_dofs, mpi_communicator);
+  TrilinosWrappers::MPI::Vector new_previous(locally_owned_dofs, mpi_communicator);
+  std::vector<TrilinosWrappers::MPI::Vector *> new_solutions = {&new_current, &new_previous};
+  solution_transfer.interpolate(new_solutions);
+
+  // Hanging nodes of the new mesh, the Dirichlet data are imposed by the next
+  // assembly.
+  for (TrilinosWrappers::MPI::Vector *v : new_solutions)
+    static_constraints.distribute(*v);
+  from_vector(new_current, solution);
+  from_vector(new_previous, previous_solution);
+  copy_to_owned(solution, solution_owned);
+
+  // The patterns of the matrices have changed.
+  yosida.clear();
+  simple.clear();
+  ayosida.clear();
+  asimple.clear();
+  augmented_lagrangian.clear();
+  recycle_space.clear();
+  operator_diagonals.clear();
+}
+
+// Function used to update the matrix-free operator after an assembly: the
+// convective velocity is the one of the convection matrix, the Newton terms
+// and the backflow stabilization are only in the assembled matrix
+template <int dim>
+void NavierStokes<dim>::update_matrix_free_operator(const bool &with_mass, const bool &newton)
+{
+  if (!matrix_free_operator)
+    return;
+
+  matrix_free_current = !newton && problem.backflow_boundary_ids().empty();
+  if (!matrix_free_current)
+    return;
+
+  matrix_free_operator->set_convective_velocity(solution, with_mass);
+  matrix_free_operator->set_constrained_diagonal(system_matrix);
+
+#ifdef DEBUG
+  // The operator must match the assembled matrix, on any partition.
+  {
+    TrilinosWrappers::MPI::BlockVector x(block_owned_dofs, mpi_communicator);
+    TrilinosWrappers::MPI::BlockVector y_matrix_free(x), y_assembled(x);
+    copy_to_owned(solution, x);
+    matrix_free_operator->vmult(y_matrix_free, x);
+    system_matrix.vmult(y_assembled, x);
+    y_assembled -= y_matrix_free;
+    Assert(y_assembled.l2_norm() <= 1e-10 * y_matrix_free.l2_norm(),
+           ExcMessage("The matrix-free operator differs from the system matrix."));
+  }
+#endif
+}
+
+// Functions used to add the convection to the system. With the matrix-free
+// operator, the velocity-velocity part of the cell matrices is added to the F
+// block only: the velocity block indices are the global DoF indices.
+template <int dim>
+void NavierStokes<dim>::distribute_cell_convection(const FullMatrix<double> &cell_convection_matrix,
+                                                   const std::vector<types::global_dof_index> &dof_indices)
+{
+  if (!matrix_free_operator)
+  {
+    constraints.distribute_local_to_global(cell_convection_matrix, dof_indices, convection_matrix);
+    return;
+  }
+
+  for (unsigned int k = 0; k < velocity_local_dofs.size(); ++k)
+    velocity_dof_indices[k] = dof_indices[velocity_local_dofs[k]];
+  cell_velocity_matrix.extract_submatrix_from(cell_convection_matrix, velocity_local_dofs,
+                                              velocity_local_dofs);
+  constraints.distribute_local_to_global(cell_velocity_matrix, velocity_dof_indices,
+                                         convection_matrix.block(0, 0));
+}
+
+template <int dim>
+void NavierStokes<dim>::add_convection_to_system(const double &factor)
+{
+  if (matrix_free_operator)
+    system_matrix.block(0, 0).add(factor, convection_matrix.block(0, 0));
+  else
+    system_matrix.add(factor, convection_matrix);
+}
+
+// Function used to enable the autotuning of the preconditioner
+template <int dim>
+void NavierStokes<dim>::enable_autotuning(const unsigned int &n_trial_steps)
+{
+  const std::string key = problem.configuration() + "_" + mesh_file_name + "_dt" + std::to_string(deltat);
+  autotuner = std::make_unique<PreconditionerAutotuner>(
+      PreconditionerAutotuner::default_candidates(), n_trial_steps, key,
+      log_prefix + "autotune.csv", mpi_communicator);
+
+  if (autotuner->load())
+    pcout << "Autotuning: reusing preconditioner " << autotuner->current().preconditioner_type
+          << " with inner tolerance " << autotuner->current().inner_tolerance
+          << " from a previous run" << std::endl;
+}
+
+// Function used to solve the linear system and assemble the preconditioner
+// (the systems of all the members of the ensemble, if ensemble_lockstep)
+template <int dim>
+void NavierStokes<dim>::solve_time_step(const double &time, const bool &ensemble_lockstep)
+{
+  pcout << "===============================================" << std::endl;
+
+  // Sparse direct solve: only the numeric factorization is repeated.
+  if (direct_solver)
+  {
+    dealii::Timer timer_direct;
+    timer_direct.restart();
+    direct_solver->factorize(system_matrix);
+    timer_direct.stop();
+    pcout << "Time taken by the numeric factorization: " << timer_direct.wall_time() << " seconds" << std::endl;
+    time_prec.push_back(timer_direct.wall_time());
+
+    timer_direct.restart();
+    direct_solver->solve(solution_owned, system_rhs);
+    timer_direct.stop();
+    pcout << "Time taken to solve Navier Stokes problem: " << timer_direct.wall_time() << " seconds" << std::endl;
+    time_solve.push_back(timer_direct.wall_time());
+
+    pcout << "Result:  direct solve (" << direct_solver->type() << ")" << std::endl;
+    constraints.distribute(solution_owned);
+    copy_to_ghosted(solution_owned, solution);
+    return;
+  }
+
+  const unsigned int maxiter = 100000;
+  double tol = 1e-4 /**system_rhs.l2_norm()*/;
+  double inner_tolerance = 1e-2;
+  // Inner tolerance of the last outer iteration.
+  double last_inner_tolerance = inner_tolerance;
+
+  // Adaptive tolerances: the outer solve reduces the residual of the initial
+  // guess by the forcing term, the inner tolerance starts from it and is
+  // relaxed with the outer residual (unless the autotuner is choosing it).
+  // The outer solver is then right preconditioned and flexible: it checks
+  // the unpreconditioned residual the forcing term is computed from, and the
+  // preconditioner may change between its iterations.
+  if (adaptive_tolerance)
+  {
+    const double initial_residual_norm =
+        system_matrix.residual(outer_residual, solution_owned, system_rhs);
+    tol = std::max(adaptive_tolerance->outer_tolerance(initial_residual_norm), 1e-14);
+    inner_tolerance = adaptive_tolerance->inner_tolerance();
+  }
+
+  ResidualMonitorControl solver_control(maxiter, tol, true);
+  // solver_control.enable_history_data();
+  SolverGMRES<TrilinosWrappers::MPI::BlockVector> solver(solver_control);
+
+  // Outer solve, with GMRES (or its low synchronization or flexible variant)
+  // or with the recycling solver, on the assembled or on the matrix-free
+  // operator
+  const auto outer_solve_with = [&](const auto &system_operator, const auto &preconditioner) {
+    if (krylov_recycling)
+    {
+      SolverGCRODR solver_gcrodr(solver_control, recycle_space, gcrodr_data);
+      solver_gcrodr.solve(system_operator, solution_owned, system_rhs, preconditioner);
+    }
+    else if (low_synchronization)
+    {
+      SolverLowSyncGMRES<TrilinosWrappers::MPI::BlockVector> solver_low_sync(solver_control);
+      solver_low_sync.solve(system_operator, solution_owned, system_rhs, preconditioner);
+    }
+    else if (adaptive_tolerance)
+    {
+      SolverFGMRES<TrilinosWrappers::MPI::BlockVector> solver_flexible(solver_control);
+      solver_flexible.solve(system_operator, solution_owned, system_rhs, preconditioner);
+    }
+    else
+      solver.solve(system_operator, solution_owned, system_rhs, preconditioner);
+  };
+  // Iterations of the outer solve (the most taken by a member of an ensemble).
+  unsigned int outer_iterations = 0;
+  const auto outer_solve = [&](const auto &preconditioner) {
+    if (ensemble_lockstep)
+    {
+      std::vector<SolverControl> member_controls(ensemble.size(), SolverControl(maxiter, tol));
+      std::vector<TrilinosWrappers::MPI::BlockVector *> member_solutions;
+      std::vector<const TrilinosWrappers::MPI::BlockVector *> member_rhs;
+      for (EnsembleMember &member : ensemble)
+      {
+        member_solutions.push_back(&member.solution_owned);
+        member_rhs.push_back(&member.system_rhs);
+      }
+      SolverEnsembleGMRES solver_ensemble(member_controls);
+      solver_ensemble.solve(system_matrix, member_solutions, member_rhs, preconditioner);
+      for (const SolverControl &member_control : member_controls)
+        outer_iterations = std::max(outer_iterations, member_control.last_step());
+    }
+    else
+    {
+      if (matrix_free_operator && matrix_free_current)
+        outer_solve_with(*matrix_free_operator, preconditioner);
+      else
+        outer_solve_with(system_matrix, preconditioner);
+      outer_iterations = solver_control.last_step();
+    }
+  };
+
+  // Assemblying the preconditioner
+  {
+
+    dealii::Timer timerprec;
+    timerprec.restart();
+    dealii::Timer timersys;
+
+    // Diagonal of F, shared by the preconditioners.
+    operator_diagonals.update_F(system_matrix.block(0, 0));
+
+    // Pressure-pressure block of the stabilized system.
+    const TrilinosWrappers::SparseMatrix *pressure_stabilization =
+        stabilization ? &system_matrix.block(1, 1) : nullptr;
+
+    // Layout of the component-wise preconditioning of F.
+    const VelocityComponents *components =
+        component_preconditioner ? &velocity_components : nullptr;
+
+    unsigned int preconditioner_type = this->preconditioner_type;
+    if (autotuner)
+    {
+      preconditioner_type = autotuner->current().preconditioner_type;
+      inner_tolerance = autotuner->current().inner_tolerance;
+    }
+    last_inner_tolerance = inner_tolerance;
+    outer_tolerances.push_back(tol);
+    inner_tolerances.push_back(inner_tolerance);
+    pcout << "Outer tolerance = " << tol << ", inner tolerance = " << inner_tolerance << std::endl;
+
+    // Relaxation of the inner tolerance of the preconditioner along the outer
+    // iterations.
+    const auto relax_inner_tolerance = [&](auto &preconditioner) {
+      if (adaptive_tolerance && !autotuner)
+        solver_control.on_residual_ratio = [&](const double &residual_ratio) {
+          last_inner_tolerance = adaptive_tolerance->inner_tolerance(residual_ratio);
+          preconditioner.set_tolerance(last_inner_tolerance);
+        };
+    };
+    // Configuration (the same for every type), initialization and outer
+    // solve with a block preconditioner, with their timings.
+    const auto configure_and_solve = [&](auto &preconditioner, const auto &initialize) {
+      preconditioner.set_tolerance(inner_tolerance);
+      relax_inner_tolerance(preconditioner);
+      preconditioner.set_single_precision(mixed_precision);
+      preconditioner.set_low_synchronization(low_synchronization);
+      preconditioner.set_velocity_components(components);
+      preconditioner.set_pressure_stabilization(pressure_stabilization);
+      initialize(preconditioner);
+      timerprec.stop();
+      pcout << "Time taken to initialize preconditioner: " << timerprec.wall_time() << " seconds" << std::endl;
+      time_prec.push_back(timerprec.wall_time());
+      timersys.restart();
+      outer_solve(preconditioner);
+      timersys.stop();
+      pcout << "Time taken to solve Navier Stokes problem: " << timersys.wall_time() << " seconds" << std::endl;
+      time_solve.push_back(timersys.wall_time());
+    };
+    // Yosida and SIMPLE variants, from F, B, B^T and the diagonals.
+    const auto initialize_segregated = [&](auto &preconditioner) {
+      preconditioner.initialize(system_matrix.block(0, 0), system_matrix.block(1, 0), system_matrix.block(0, 1), operator_diagonals, solution_owned);
+    };
+
+    switch (preconditioner_type)
+    {
+        // Yosida
+        case 0:
+            configure_and_solve(yosida, initialize_segregated);
+            break;
+
+        // SIMPLE
+        case 1:
+            configure_and_solve(simple, initialize_segregated);
+            break;
+
+        // aYosida
+        case 2:
+            configure_and_solve(ayosida, initialize_segregated);
+            break;
+
+        // aSIMPLE
+        case 3:
+            configure_and_solve(asimple, initialize_segregated);
+            break;
+
+        // Augmented Lagrangian
+        case 4:
+            AssertThrow(grad_div > 0., ExcMessage("The augmented Lagrangian preconditioner needs the grad-div term."));
+            // The pressure mass matrix is assembled as Mp / nu.
+            configure_and_solve(augmented_lagrangian, [&](PreconditionAugmentedLagrangian &preconditioner) {
+              preconditioner.initialize(system_matrix.block(0, 0), system_matrix.block(0, 1), pressure_mass.block(1, 1), (nu + grad_div) / nu, solution_owned);
+            });
+            break;
+
+        default:
+            throw std::runtime_error("Invalid preconditioner type");
+    }
+  }
+  pcout << "Result:  " << outer_iterations
+        << (krylov_recycling ? " GCRO-DR iterations" : " GMRES iterations") << std::endl;
+
+  if (autotuner && !autotuner->is_locked())
+  {
+    autotuner->record(time_prec.back(), time_solve.back(), outer_iterations);
+    if (autotuner->is_locked())
+      pcout << "Autotuning: selected preconditioner " << autotuner->current().preconditioner_type
+            << " with inner tolerance " << autotuner->current().inner_tolerance << std::endl;
+  }
+
+  // Write the GMRES iterations to "gmres.csv"
+  if (mpi_rank == 0) // Ensure only the root process writes to the file
+  {
+      std::ofstream gmres_file(log_prefix + "gmres.csv", std::ios::app); // Open in append mode
+      if (gmres_file.is_open())
+      {
+          gmres_file << time << ',' << int(problem.reynolds_number()) << ',' << outer_iterations << "\n";
+          gmres_file.close();
+      }
+      else
+      {
+          pcout << "Error: Unable to open gmres.csv for writing." << std::endl;
+      }
+  }
+  // Write the tolerances (outer, first and last inner) to "tolerances.csv"
+  if (mpi_rank == 0)
+  {
+      std::ofstream tolerances_file(log_prefix + "tolerances.csv", std::ios::app);
+      if (tolerances_file.is_open())
+          tolerances_file << time << ',' << tol << ',' << inner_tolerance << ','
+                          << last_inner_tolerance << ',' << outer_iterations << "\n";
+      else
+          pcout << "Error: Unable to open tolerances.csv for writing." << std::endl;
+  }
+  // Values of the constrained DoFs (distributed by the caller for the
+  // members of an ensemble).
+  if (ensemble_lockstep)
+    return;
+  constraints.distribute(solution_owned);
+  copy_to_ghosted(solution_owned, solution);
+
+}
+
+// Functions used to move the locally owned entries between the solver
+// vectors and the vectors with ghost elements. The locally owned entries are
+// stored contiguously, in the same order, in both of them.
+template <int dim>
+void NavierStokes<dim>::copy_to_ghosted(const TrilinosWrappers::MPI::BlockVector &src,
+                                        LinearAlgebra::distributed::BlockVector<double> &dst) const
+{
+  for (unsigned int block = 0; block < src.n_blocks(); ++block)
+  {
+    const Epetra_MultiVector &src_epetra = src.block(block).trilinos_vector();
+    AssertDimension(static_cast<unsigned int>(src_epetra.MyLength()),
+                    dst.block(block).locally_owned_size());
+    std::copy(src_epetra[0], src_epetra[0] + src_epetra.MyLength(), dst.block(block).begin());
+  }
+  dst.update_ghost_values();
+}
+
+template <int dim>
+void NavierStokes<dim>::copy_to_owned(const LinearAlgebra::distributed::BlockVector<double> &src,
+                                      TrilinosWrappers::MPI::BlockVector &dst) const
+{
+  for (unsigned int block = 0; block < dst.n_blocks(); ++block)
+  {
+    Epetra_MultiVector &dst_epetra = dst.block(block).trilinos_vector();
+    AssertDimension(static_cast<unsigned int>(dst_epetra.MyLength()),
+                    src.block(block).locally_owned_size());
+    std::copy(src.block(block).begin(), src.block(block).begin() + dst_epetra.MyLength(), dst_epetra[0]);
+  }
+}
+
+// Function used to save the output of the simulation
+template <int dim>
+void NavierStokes<dim>::output(const unsigned int &time_step) const
+{
+    pcout << "===============================================" << std::endl;
+
+    DataOut<dim> data_out;
+
+    std::vector<DataComponentInterpretation::DataComponentInterpretation>
+        data_component_interpretation(
+            dim, DataComponentInterpretation::component_is_part_of_vector);
+    data_component_interpretation.push_back(
+        DataComponentInterpretation::component_is_scalar);
+    std::vector<std::string> names(dim, "velocity");
+    names.push_back("pressure");
+
+    data_out.add_data_vector(dof_handler,
+                            solution,
+                            names,
+                            data_component_interpretation);
+
+    std::vector<unsigned int> partition_int(mesh->n_active_cells());
+    GridTools::get_subdomain_association(*mesh, partition_int);
+    const Vector<double> partitioning(partition_int.begin(), partition_int.end());
+    data_out.add_data_vector(partitioning, "partitioning");
+
+    data_out.build_patches();
+
+    // Only Save one .vtu file, if you want to have one for each processor change last parameter to 0
+    const std::string output_file_name = "output-navier-stokes-" + problem.name();
+    data_out.write_vtu_with_pvtu_record(problem.output_directory(),
+                                        output_file_name,
+                                        time_step,
+                                        mpi_communicator,
+                                        numbers::invalid_unsigned_int,
+                                        1);
+
+    pcout << "Output written to " << output_file_name << std::endl;
+    pcout << "===============================================" << std::endl;
+}
+
+
+// Function used to update time step and call the solver, compute the forces and output the results
+template <int dim>
+void NavierStokes<dim>::solve()
+{
+
+  pcout << "===============================================" << std::endl;
+
+  // Apply the initial condition.
+  {
+    pcout << "Applying the initial condition" << std::endl;
+
+    problem.set_time(0.0);
+    VectorTools::interpolate(dof_handler, problem.initial_condition(), solution_owned);
+    copy_to_ghosted(solution_owned, solution);
+
+    // Output the initial solution.
+    output(0);
+    pcout << "===============================================" << std::endl;
+  }
+
+  const bool has_obstacle = problem.obstacle_boundary_id() != numbers::invalid_boundary_id;
+  std::vector<double> coefficients;
+  double c_D_max = -999;
+  double c_L_min = 999;
+  unsigned int time_step = 0;
+  double time = 0;
+  while (time < T - 0.5 * deltat)
+  {
+
+    time += deltat;
+    ++time_step;
+    problem.set_time(time);
+
+    pcout << "n = " << std::setw(3) << time_step << ", t = " << std::setw(5)
+          << time << ":" << std::flush;
+
+
+    // Initial guess of the solver: 2 u^n - u^{n-1} (solution_owned holds u^n)
+    if (extrapolate_initial_guess && time_step > 1)
+    {
+      copy_to_owned(previous_solution, old_solution_owned);
+      solution_owned.sadd(2.0, -1.0, old_solution_owned);
+    }
+
+    if (nonlinear_solver == NonlinearSolver::semi_implicit)
+    {
+      if (static_matrices_outdated) assemble(time);
+      else assemble_time_step(time);
+
+      // solution is overwritten by the solve, so the vectors are swapped
+      // instead of copied
+      previous_solution.swap(solution);
+      solve_time_step(time);
+
+      // Relative change of the solution over the step, for the tolerances of
+      // the next one (old_solution_owned is only needed at the beginning of
+      // a step, so it is used here as a temporary)
+      if (adaptive_tolerance)
+      {
+        copy_to_owned(previous_solution, old_solution_owned);
+        old_solution_owned -= solution_owned;
+        const double solution_norm = solution_owned.l2_norm();
+        if (solution_norm > 0.0)
+          adaptive_tolerance->update_from_solution_change(old_solution_owned.l2_norm() / solution_norm);
+      }
+    }
+    else
+    {
+      // The static matrices are needed by the nonlinear iterations.
+      if (static_matrices_outdated) assemble(time);
+      solve_nonlinear(time, false);
+    }
+
+    // Since the starting solution t0 is zero we avoid the initial high forces values
+    if (has_obstacle && time > problem.forces_start_time())
+    {
+      if (time == T - deltat)
+        compute_pressure_difference();
+
+      coefficients = compute_forces();
+      c_D_max = std::max(c_D_max, coefficients[0]);
+      c_L_min = std::min(c_L_min, coefficients[1]);
+
+      // Write coefficients to "coeff_<problem>.csv"
+      if (mpi_rank == 0) // Ensure only the root process writes to the file
+      {
+          std::ofstream coeff_file("coeff_" + problem.name() + ".csv", std::ios::app); // Open in append mode
+          if (coeff_file.is_open())
+          {
+              coeff_file << time_step << "," << coefficients[0] << "," << coefficients[1] << "\n";
+              coeff_file.close();
+          }
+          else
+          {
+              pcout << "Error: Unable to open coeff.csv for writing." << std::endl;
+          }
+      }
+    }
+
+    if (time_step % problem.output_interval() == 0) output(time_step);
+
+    // Adapt the mesh to the wake.
+    if (adaptive_refinement && time_step % adaptive_refinement->interval == 0 &&
+        time < T - 0.5 * deltat)
+      refine_mesh();
+  }
+
+  if (has_obstacle)
+  {
+    pcout << "===============================================" << std::endl;
+    pcout << "Drag Coefficient Max ----->   " << c_D_max << std::endl;
+    pcout << std::endl;
+    pcout << "Lift Coefficient Min ----->   " << c_L_min << std::endl;
+    pcout << "===============================================" << std::endl;
+  }
+}
+
+// Function used to solve an ensemble of flows sharing the mesh. With the
+// convection linearized around the ensemble mean u_mean, the k-th member
+// solves
+//
+//   u_k/dt + C(u_mean^n) u_k + A u_k + B^T p_k = u_k^n/dt + f - C'_k
+//
+// where C'_k = (grad u_k^n)(u_k^n - u_mean^n) + 1/2 div(u_k^n - u_mean^n) u_k^n
+// is the fluctuation of the convection, treated explicitly: the system matrix
+// is the same for all the members.
+template <int dim>
+void NavierStokes<dim>::solve_ensemble()
+{
+  AssertThrow(!ensemble.empty(), ExcMessage("Call enable_ensemble() before setup()."));
+  AssertThrow(nonlinear_solver == NonlinearSolver::semi_implicit && !stabilization &&
+                  !adaptive_refinement && !matrix_free_operator && !autotuner &&
+                  !adaptive_tolerance && !krylov_recycling &&
+                  problem.backflow_boundary_ids().empty(),
+              ExcMessage("The ensemble is solved with the semi-implicit scheme on a fixed "
+                         "mesh, without stabilization, matrix-free operator, autotuning, "
+                         "adaptive tolerances or Krylov recycling."));
+
+  pcout << "===============================================" << std::endl;
+
+  // Apply the initial condition, scaled as the Dirichlet data of each member.
+  {
+    pcout << "Applying the initial condition to " << ensemble.size() << " members" << std::endl;
+
+    problem.set_time(0.0);
+    VectorTools::interpolate(dof_handler, problem.initial_condition(), solution_owned);
+    for (EnsembleMember &member : ensemble)
+    {
+      member.solution_owned = solution_owned;
+      member.solution_owned *= member.scaling;
+      copy_to_ghosted(member.solution_owned, member.solution);
+    }
+    update_ensemble_mean();
+
+    // Output the initial ensemble mean.
+    output(0);
+    pcout << "===============================================" << std::endl;
+  }
+
+  const bool has_obstacle = problem.obstacle_boundary_id() != numbers::invalid_boundary_id;
+  unsigned int time_step = 0;
+  double time = 0;
+  while (time < T - 0.5 * deltat)
+  {
+    time += deltat;
+    ++time_step;
+    problem.set_time(time);
+
+    pcout << "n = " << std::setw(3) << time_step << ", t = " << std::setw(5)
+          << time << ":" << std::flush;
+
+    // Shared matrix, around the ensemble mean held by solution (the rhs of
+    // the mean is not needed).
+    if (static_matrices_outdated) assemble(time);
+    else assemble_time_step(time, false);
+
+    assemble_ensemble_rhs(time);
+    solve_ensemble_time_step(time);
+    update_ensemble_mean();
+
+    if (has_obstacle && time > problem.forces_start_time())
+    {
+      const double reference_force = problem.reference_force();
+      for (unsigned int k = 0; k < ensemble.size(); ++k)
+      {
+        const std::vector<double> forces = integrate_forces(ensemble[k].solution);
+        const double member_reference_force =
+            ensemble[k].scaling * ensemble[k].scaling * reference_force;
+        ensemble_drag_coeff[k].push_back(forces[0] / member_reference_force);
+        ensemble_lift_coeff[k].push_back(forces[1] / member_reference_force);
+        pcout << "Member " << k << " coeff:\t " << ensemble_drag_coeff[k].back()
+              << " Coeff:\t " << ensemble_lift_coeff[k].back() << std::endl;
+      }
+    }
+
+    if (time_step % problem.output_interval() == 0) output(time_step);
+  }
+}
+
+// Function used to assemble the right-hand sides of the members of the
+// ensemble, the system matrix being already assembled around the mean
+template <int dim>
+void NavierStokes<dim>::assemble_ensemble_rhs(const double &time)
+{
+  const unsigned int dofs_per_cell = fe->dofs_per_cell;
+  const unsigned int n_q = quadrature->size();
+  const unsigned int n_q_boundary = quadrature_boundary->size();
+
+  FEValues<dim> fe_values(*fe,
+                          *quadrature,
+                          update_values | update_gradients |
+                              update_quadrature_points | update_JxW_values);
+  FEFaceValues<dim> fe_boundary_values(*fe,
+                                       *quadrature_boundary,
+                                       update_values | update_quadrature_points |
+                                           update_JxW_values);
+
+  FullMatrix<double> cell_convection_matrix(dofs_per_cell, dofs_per_cell);
+  FullMatrix<double> cell_matrix(dofs_per_cell, dofs_per_cell);
+  Vector<double> mean_cell_rhs(dofs_per_cell);
+  Vector<double> neumann_cell_rhs(dofs_per_cell);
+  Vector<double> cell_rhs(dofs_per_cell);
+  std::vector<types::global_dof_index> dof_indices(dofs_per_cell);
+
+  problem.set_time(time);
+  for (EnsembleMember &member : ensemble)
+  {
+    update_constraints(member.constraints, member.scaling);
+    member.system_rhs = 0.0;
+  }
+
+  FEValuesExtractors::Vector velocity(0);
+
+  const Function<dim> &forcing_term = problem.forcing_term();
+  const Function<dim> &function_h = problem.neumann_function();
+  const std::set<types::boundary_id> neumann_ids = problem.neumann_boundary_ids();
+  Vector<double> forcing_term_loc(forcing_term.n_components);
+  Vector<double> neumann_loc(function_h.n_components);
+
+  std::vector<Tensor<1, dim>> mean_velocity_values(n_q);
+  std::vector<double> mean_velocity_divergence(n_q);
+  std::vector<Tensor<1, dim>> member_velocity_values(n_q);
+  std::vector<Tensor<2, dim>> member_velocity_gradients(n_q);
+  std::vector<double> member_velocity_divergence(n_q);
+  std::vector<Tensor<1, dim>> forcing_values(n_q);
+
+  for (const auto &cell : dof_handler.active_cell_iterators())
+  {
+    if (!cell->is_locally_owned())
+      continue;
+
+    fe_values.reinit(cell);
+    cell->get_dof_indices(dof_indices);
+
+    fe_values[velocity].get_function_values(solution, mean_velocity_values);
+    fe_values[velocity].get_function_divergences(solution, mean_velocity_divergence);
+
+    for (unsigned int q = 0; q < n_q; ++q)
+    {
+      forcing_term.vector_value(fe_values.quadrature_point(q),
+                                forcing_term_loc);
+      for (unsigned int d = 0; d < dim; ++d)
+        forcing_values[q][d] = forcing_term_loc[d];
+    }
+
+    // The lifting of the Dirichlet data needs the shared convection matrix
+    // (the rhs of the mean, computed by the same kernel, is not used).
+    if (constrained_cell_matrices.count(cell->active_cell_index()))
+      cell_assembler.assemble_cell_convection(fe_values,
+                                              mean_velocity_values,
+                                              mean_velocity_divergence,
+                                              forcing_values,
+                                              deltat,
+                                              cell_convection_matrix,
+                                              mean_cell_rhs);
+
+    // Neumann terms, the same for all the members.
+    neumann_cell_rhs = 0.0;
+    if (cell->at_boundary())
+    {
+      for (unsigned int f = 0; f < cell->n_faces(); ++f)
+      {
+        if (!cell->face(f)->at_boundary() ||
+            !neumann_ids.count(cell->face(f)->boundary_id()))
+          continue;
+
+        fe_boundary_values.reinit(cell, f);
+
+        for (unsigned int q = 0; q < n_q_boundary; ++q)
+        {
+          function_h.vector_value(fe_boundary_values.quadrature_point(q),
+                                  neumann_loc);
+          Tensor<1, dim> neumann_loc_tensor;
+          for (unsigned int d = 0; d < dim; ++d)
+            neumann_loc_tensor[d] = neumann_loc[d];
+
+          for (unsigned int i = 0; i < dofs_per_cell; ++i)
+            neumann_cell_rhs(i) +=
+                scalar_product(neumann_loc_tensor,
+                               fe_boundary_values[velocity].value(i, q)) *
+                fe_boundary_values.JxW(q);
+        }
+      }
+    }
+
+    for (EnsembleMember &member : ensemble)
+    {
+      fe_values[velocity].get_function_values(member.solution, member_velocity_values);
+      fe_values[velocity].get_function_gradients(member.solution, member_velocity_gradients);
+      fe_values[velocity].get_function_divergences(member.solution, member_velocity_divergence);
+
+      cell_rhs = neumann_cell_rhs;
+      for (unsigned int q = 0; q < n_q; ++q)
+      {
+        // Time derivative, forcing term and fluctuation of the convection.
+        const Tensor<1, dim> load =
+            member_velocity_values[q] / deltat + forcing_values[q] -
+            member_velocity_gradients[q] * (member_velocity_values[q] - mean_velocity_values[q]) -
+            0.5 * (member_velocity_divergence[q] - mean_velocity_divergence[q]) * member_velocity_values[q];
+
+        for (unsigned int i = 0; i < dofs_per_cell; ++i)
+          cell_rhs(i) += scalar_product(load, fe_values[velocity].value(i, q)) * fe_values.JxW(q);
+      }
+
+      distribute_cell_rhs(cell, dof_indices, cell_rhs, cell_convection_matrix, true,
+                          cell_matrix, member.constraints, member.system_rhs);
+    }
+  }
+
+  for (EnsembleMember &member : ensemble)
+  {
+    member.system_rhs.compress(VectorOperation::add);
+    // Boundary values on the initial guess of the solve.
+    member.constraints.distribute(member.solution_owned);
+  }
+}
+
+// Function used to solve the systems of the members of the ensemble: one
+// factorization (or one preconditioner setup and a lockstep GMRES) for all
+// of them
+template <int dim>
+void NavierStokes<dim>::solve_ensemble_time_step(const double &time)
+{
+  if (direct_solver)
+  {
+    pcout << "===============================================" << std::endl;
+
+    dealii::Timer timer_direct;
+    timer_direct.restart();
+    direct_solver->factorize(system_matrix);
+    timer_direct.stop();
+    pcout << "Time taken by the numeric factorization: " << timer_direct.wall_time() << " seconds" << std::endl;
+    time_prec.push_back(timer_direct.wall_time());
+
+    std::vector<TrilinosWrappers::MPI::BlockVector *> member_solutions;
+    std::vector<const TrilinosWrappers::MPI::BlockVector *> member_rhs;
+    for (EnsembleMember &member : ensemble)
+    {
+      member_solutions.push_back(&member.solution_owned);
+      member_rhs.push_back(&member.system_rhs);
+    }
+
+    timer_direct.restart();
+    direct_solver->solve(member_solutions, member_rhs);
+    timer_direct.stop();
+    pcout << "Time taken to solve the " << ensemble.size() << " members: "
+          << timer_direct.wall_time() << " seconds" << std::endl;
+    time_solve.push_back(timer_direct.wall_time());
+  }
+  else
+  {
+    // One preconditioner setup, then the members are solved in lockstep.
+    solve_time_step(time, true);
+  }
+
+  // Values of the constrained DoFs, with the data of each member.
+  for (EnsembleMember &member : ensemble)
+  {
+    member.constraints.distribute(member.solution_owned);
+    copy_to_ghosted(member.solution_owned, member.solution);
+  }
+}
+
+// Function used to compute the ensemble mean, the linearization point of
+// the shared system matrix
+template <int dim>
+void NavierStokes<dim>::update_ensemble_mean()
+{
+  solution_owned = 0.0;
+  for (const EnsembleMember &member : ensemble)
+    solution_owned.add(1.0 / ensemble.size(), member.solution_owned);
+  copy_to_ghosted(solution_owned, solution);
+}
+
+// Function used to compute the forces acting on the body
+template <int dim>
+std::vector<double> NavierStokes<dim>::compute_forces()
+{
+  pcout << "===============================================" << std::endl;
+  pcout << "Computing forces: " << std::endl;
+
+   const std::vector<double> forces = integrate_forces(this->solution);
+   const double total_drag = forces[0];
+   const double total_lift = forces[1];
+   pcout << "Drag :\t " << total_drag << " Lift :\t " << total_lift << std::endl;
+
+   const double reference_force = problem.reference_force();
+   const double c_d = total_drag / reference_force;
+   const double c_l = total_lift / reference_force;
+
+   vec_drag.push_back(total_drag);
+   vec_lift.push_back(total_lift);
+   vec_drag_coeff.push_back(c_d);
+   vec_lift_coeff.push_back(c_l);
+
+   std::vector<double> coefficients = { c_d , c_l };
+   pcout << "Coeff:\t " << c_d << " Coeff:\t " << c_l << std::endl;
+
+  pcout << "===============================================" << std::endl;
+  return coefficients;
+}
+
+// Function used to integrate the stress of a solution on the obstacle
+template <int dim>
+std::vector<double>
+NavierStokes<dim>::integrate_forces(const LinearAlgebra::distributed::BlockVector<double> &flow) const
+{
+   const unsigned int n_q_points = quadrature_boundary->size();
+
+   // Define FE extractors for velocity and pressure
+   FEValuesExtractors::Vector velocities(0);
+   FEValuesExtractors::Scalar pressure(dim);
+
+   // Containers to store evaluated values
+   std::vector<double>         pressure_values(n_q_points);
+   std::vector<Tensor<2, dim>> velocity_gradients(n_q_points);
+
+   // Initialize FE face values
+   FEFaceValues<dim> fe_face_values(*this->fe,
+                                    *quadrature_boundary,
+                                    update_values | update_quadrature_points |
+                                    update_gradients | update_JxW_values |
+                                    update_normal_vectors);
+
+   // Initialize tensors for calculations
+   Tensor<1, dim> normal_vector;
+   Tensor<2, dim> fluid_stress;
+   Tensor<2, dim> fluid_pressure;
+   Tensor<1, dim> forces;
+
+   // Initialize drag and lift accumulators
+   double local_drag = 0.0;
+   double local_lift = 0.0;
+
+   const types::boundary_id obstacle_id = problem.obstacle_boundary_id();
+
+   // Iterate over all cells
+   for (const auto &cell : this->dof_handler.active_cell_iterators())
+   {
+       if (!cell->is_locally_owned())
+           continue;
+
+       if (!cell->at_boundary())
+           continue;
+
+       for (unsigned int f = 0; f < cell->n_faces(); ++f)
+       {
+           // Determine if current face is where stress should be evaluated
+           if (!cell->face(f)->at_boundary() ||
+               cell->face(f)->boundary_id() != obstacle_id)
+               continue;
+
+           // Reinitialize FE face values for the current face
+           fe_face_values.reinit(cell, f);
+
+           // Retrieve velocity gradients and pressure values on the face
+           fe_face_values[velocities].get_function_gradients(flow, velocity_gradients);
+           fe_face_values[pressure].get_function_values(flow, pressure_values);
+
+           // Iterate over quadrature points on the face
+           for (unsigned int q = 0; q < n_q_points; ++q)
+           {
+               // Get the normal vector
+               normal_vector = -fe_face_values.normal_vector(q);
+
+               // Compute fluid pressure tensor (p * I)
+               fluid_pressure = 0;
+               for (unsigned int d = 0; d < dim; ++d)
+                   fluid_pressure[d][d] = pressure_values[q];
+
+               // Compute fluid stress tensor (rho * nu * grad(U) - pI)
+               fluid_stress = this->rho * this->nu * velocity_gradients[q] - fluid_pressure;
+
+               // Compute forces: stress tensor contracted with normal vector and scaled by JxW
+               forces = fluid_stress * normal_vector * fe_face_values.JxW(q);
+
+               // Accumulate drag and lift using the scaling factor
+               local_drag += forces[0];
+               local_lift += forces[1];
+           }
+       }
+   }
+
+   return {Utilities::MPI::sum(local_drag, mpi_communicator),
+           Utilities::MPI::sum(local_lift, mpi_communicator)};
+}
+
+
+template <int dim>
+void NavierStokes<dim>::compute_pressure_difference()
+{
+  const std::vector<Point<dim>> probe_points = problem.pressure_probe_points();
+  if (probe_points.size() < 2)
+    return;
+
+  const Point<dim> &p_a = probe_points[0];
+  const Point<dim> &p_e = probe_points[1];
+
+  Vector<double> solution_values1(dim + 1);
+  Vector<double> solution_values2(dim + 1);
+
+
+  bool p1_available = true;
+  bool p2_available = true;
+
+  // Attempt to evaluate pressure at p1
+  try
+  {
+      VectorTools::point_value(this->dof_handler, this->solution, p_a,
+                               solution_values1);
+  }
+  catch (const dealii::VectorTools::ExcPointNotAvailableHere &)
+  {
+      p1_available = false;
+  }
+
+  // Attempt to evaluate pressure at p2
+  try
+  {
+      VectorTools::point_value(this->dof_handler, this->solution, p_e,
+                               solution_values2);
+  }
+  catch (const dealii::VectorTools::ExcPointNotAvailableHere &)
+  {
+      p2_available = false;
+  }
+
+    // Initialize pressure variables
+    double pres_point1 = 0.0;
+    double pres_point2 = 0.0;
+
+    // Assign local pressure values if available
+    if (p1_available)
+        pres_point1 = solution_values1(dim);
+    if (p2_available)
+        pres_point2 = solution_values2(dim);
+
+    // Reduce pressure points to rank 0
+    double global_pres_point1 = 0.0;
+    double global_pres_point2 = 0.0;
+
+    // Assuming only one process has each pressure point, use MPI_MAX to gather the value
+    MPI_Reduce(&pres_point1, &global_pres_point1, 1, MPI_DOUBLE, MPI_MAX, 0, mpi_communicator);
+    MPI_Reduce(&pres_point2, &global_pres_point2, 1, MPI_DOUBLE, MPI_MAX, 0, mpi_communicator);
+
+    if (this->mpi_rank == 0)
+    {
+        // Compute pressure difference
+        double p_diff = global_pres_point1 - global_pres_point2;
+        pcout << "Pressure difference (P(A) - P(B)) = " << p_diff << std::endl;
+    }
+    // Ensure all processes have completed the reductions
+    MPI_Barrier(mpi_communicator);
+}
+
+template <int dim>
+double
+NavierStokes<dim>::compute_error(const VectorTools::NormType &norm_type)
+{
+  const Function<dim> *exact_solution = problem.exact_solution();
+  AssertThrow(exact_solution != nullptr,
+              ExcMessage("The problem has no exact solution."));
+
+  // Linear mapping and quadrature of the cells of the mesh (hexahedra or
+  // simplices).
+  std::unique_ptr<Mapping<dim>> mapping;
+  std::unique_ptr<Quadrature<dim>> quadrature_error;
+  if (hex_mesh)
+  {
+    mapping = std::make_unique<MappingQ1<dim>>();
+    quadrature_error = std::make_unique<QGauss<dim>>(fe->degree + 2);
+  }
+  else
+  {
+    FE_SimplexP<dim> fe_linear(1);
+    mapping = std::make_unique<MappingFE<dim>>(fe_linear);
+    quadrature_error = std::make_unique<QGaussSimplex<dim>>(fe->degree + 2);
+  }
+
+  problem.set_time(T); //calculate error at the last step
+
+  Vector<double> error_per_cell;
+
+  // Mask: select only the velocity components
+  ComponentSelectFunction<dim> velocity_mask(std::make_pair(0U, dim), dim + 1);
+
+  VectorTools::integrate_difference(*mapping,
+                                    dof_handler,
+                                    solution,
+                                    *exact_solution,
+                                    error_per_cell,
+                                    *quadrature_error,
+                                    norm_type,
+                                    &velocity_mask);
+
+  const double error =
+    VectorTools::compute_global_error(*mesh, error_per_cell, norm_type);
+
+  return error;
+}
+
+template class NavierStokes<2>;
+template class NavierStokes<3>;
@@ -0,0 +1,171 @@
+#include "../include/NavierStokes.hpp"
+#include "../include/FlowPastCylinder.hpp"
+
+// Ensemble of 2D flows past a cylinder with different parameters (test case,
+// maximum inlet velocity, viscosity). MPI_COMM_WORLD is split into one
+// sub-communicator per member, made of contiguous ranks, and the members run
+// concurrently, each with its own NavierStokes instance. With --shared-mesh,
+// the members (which then differ by the inlet velocity only) are solved
+// together on all the processes, sharing the system matrix of each step and
+// its preconditioner, in a lockstep GMRES (or its factorization with --direct).
+int main(int argc, char *argv[])
+{
+  Utilities::MPI::MPI_InitFinalize mpi_init(argc, argv);
+  const unsigned int world_size = Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD);
+  const unsigned int world_rank = Utilities::MPI::this_mpi_process(MPI_COMM_WORLD);
+
+  struct Member
+  {
+    unsigned int test_case;
+    double u_m;
+    double nu;
+  };
+
+  // Mesh File, and one --member test_case,u_m,nu per member of the ensemble
+  // (by default a sweep over the inlet velocity and the viscosity of test
+  // case 2), --shared-mesh to solve them together and --direct to do so
+  // with a sparse direct solver
+  std::string mesh_file_name = "../mesh/Cylinder2D.msh";
+  std::vector<Member> members;
+  bool shared_mesh = false;
+  bool direct = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::string(argv[i]) == "--shared-mesh")
+      shared_mesh = true;
+    else if (std::string(argv[i]) == "--direct")
+      direct = true;
+    else if (std::string(argv[i]) == "--member" && i + 1 < argc)
+    {
+      Member member;
+      char separator;
+      std::istringstream parameters(argv[++i]);
+      parameters >> member.test_case >> separator >> member.u_m >> separator >> member.nu;
+      AssertThrow(parameters, ExcMessage("A member is given as test_case,u_m,nu"));
+      members.push_back(member);
+    }
+    else
+      mesh_file_name = argv[i];
+  }
+  if (members.empty() && shared_mesh)
+    members = {{2, 1.5, 1e-3}, {2, 1.25, 1e-3}, {2, 1.0, 1e-3}, {2, 0.75, 1e-3}};
+  else if (members.empty())
+    members = {{2, 1.5, 1e-3}, {2, 1.0, 1e-3}, {2, 1.5, 2e-3}, {2, 1.0, 2e-3}};
+
+  // Using TAYLOR-HOOD ELEMENTS
+  const unsigned int degree_velocity = 2;
+  const unsigned int degree_pressure = 1;
+
+  // Time variables
+  const double T = 8.0;
+  const double deltat = 0.01;
+
+  // Members sharing the mesh: the inlet velocity of each one is that of the
+  // first member scaled.
+  if (shared_mesh)
+  {
+    std::vector<double> scalings;
+    for (const Member &member : members)
+    {
+      AssertThrow(member.test_case == members[0].test_case && member.nu == members[0].nu,
+                  ExcMessage("The members sharing the mesh differ by the inlet velocity only."));
+      scalings.push_back(member.u_m / members[0].u_m);
+    }
+
+    dealii::Timer timer;
+    timer.restart();
+
+    FlowPastCylinder<2> flow_past_cylinder(members[0].test_case, members[0].u_m, members[0].nu,
+                                           "-shared");
+    NavierStokes<2> problem(flow_past_cylinder, mesh_file_name, degree_velocity, degree_pressure,
+                            T, deltat);
+
+    // aSIMPLE
+    problem.set_preconditioner_type(3);
+    problem.set_log_prefix(flow_past_cylinder.name() + "_");
+    if (direct)
+      problem.enable_direct_solver();
+    problem.enable_ensemble(scalings);
+    problem.setup();
+    problem.solve_ensemble();
+
+    timer.stop();
+    const double wall_time = Utilities::MPI::max(timer.wall_time(), MPI_COMM_WORLD);
+
+    if (world_rank == 0)
+    {
+      for (unsigned int k = 0; k < members.size(); ++k)
+      {
+        const std::string output_filename =
+            "forces_results_" + flow_past_cylinder.name() + "-member" + std::to_string(k) + ".csv";
+        std::ofstream outputFile(output_filename);
+        AssertThrow(outputFile.is_open(), ExcMessage("Error opening " + output_filename));
+
+        outputFile << "Iteration, Coeff Drag, CoeffLift" << std::endl;
+        for (size_t ite = 0; ite < problem.ensemble_drag_coeff[k].size(); ite++)
+          outputFile << ite * deltat << ", " << problem.ensemble_drag_coeff[k][ite] << ", "
+                     << problem.ensemble_lift_coeff[k][ite] << std::endl;
+      }
+
+      std::cout << "Time taken to solve the ensemble of " << members.size()
+                << " members on a shared mesh: " << wall_time << " seconds" << std::endl;
+    }
+
+    return 0;
+  }
+
+  AssertThrow(world_size >= members.size(),
+              ExcMessage("The ensemble needs at least one process per member."));
+
+  // Group of processes of this rank, the groups differing by one process at
+  // most.
+  const unsigned int member_index = world_rank * members.size() / world_size;
+  MPI_Comm member_comm;
+  MPI_Comm_split(MPI_COMM_WORLD, member_index, world_rank, &member_comm);
+  const unsigned int member_rank = Utilities::MPI::this_mpi_process(member_comm);
+  const Member &member = members[member_index];
+
+  dealii::Timer timer;
+  timer.restart();
+  {
+    FlowPastCylinder<2> flow_past_cylinder(member.test_case, member.u_m, member.nu,
+                                           "-member" + std::to_string(member_index));
+    NavierStokes<2> problem(flow_past_cylinder, mesh_file_name, degree_velocity, degree_pressure,
+                            T, deltat, member_comm);
+
+    // aSIMPLE
+    problem.set_preconditioner_type(3);
+    problem.set_log_prefix(flow_past_cylinder.name() + "_");
+    problem.setup();
+    problem.solve();
+
+    if (member_rank == 0)
+    {
+      const std::string output_filename = "forces_results_" + flow_past_cylinder.name() + ".csv";
+      std::ofstream outputFile(output_filename);
+      AssertThrow(outputFile.is_open(), ExcMessage("Error opening " + output_filename));
+
+      outputFile << "Iteration, Drag, Lift, Coeff Drag, CoeffLift, time prec, time solve" << std::endl;
+      for (size_t ite = 0; ite < problem.vec_drag.size(); ite++)
+        outputFile << ite * deltat << ", " << problem.vec_drag[ite] << ", " << problem.vec_lift[ite] << ", "
+                   << problem.vec_drag_coeff[ite] << ", " << problem.vec_lift_coeff[ite] << ", "
+                   << problem.time_prec[ite] << ", " << problem.time_solve[ite]
+                   << std::endl;
+
+      std::cout << "Member " << member_index << " (test case " << member.test_case
+                << ", u_m = " << member.u_m << ", nu = " << member.nu << ") done on "
+                << Utilities::MPI::n_mpi_processes(member_comm) << " processes" << std::endl;
+    }
+  }
+  timer.stop();
+
+  MPI_Comm_free(&member_comm);
+
+  // The ensemble takes as long as its slowest member.
+  const double wall_time = Utilities::MPI::max(timer.wall_time(), MPI_COMM_WORLD);
+  if (world_rank == 0)
+    std::cout << "Time taken to solve the ensemble of " << members.size()
+              << " members: " << wall_time << " seconds" << std::endl;
+
+  return 0;
+}
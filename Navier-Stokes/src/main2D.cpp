@@ -1,4 +1,5 @@
-#include "../include/NavierStokes2D.hpp"
+#include "../include/NavierStokes.hpp"
+#include "../include/FlowPastCylinder.hpp"
 
 // Main function.
 int main(int argc, char *argv[])
@@ -10,11 +11,86 @@ int main(int argc, char *argv[])
   int rank;
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-  // Mesh File
-  const std::string mesh_file_name = argc > 1 ? argv[1] : "../mesh/Cylinder2D.msh";
+  // Mesh File, pass --autotune to autotune the preconditioner, --recycle to
+  // recycle Krylov subspaces between the linear solves, --newton to
+  // solve each time step with Newton iterations, --steady to solve the
+  // steady test case 1 (Re = 20) with Newton iterations, --mixed-precision
+  // to use single precision inner preconditioners, --adaptive-tolerances
+  // to adapt the tolerances of the linear solves, --low-sync to use the
+  // low synchronization Krylov solvers, --direct to use a sparse direct
+  // solver (KLU), --shared-memory to share the ghost entries within a node,
+  // --hex to solve on a Q2/Q1 hexahedral mesh, --amr to adapt it to the wake
+  // (with both the mesh file is not used), --matrix-free to apply the
+  // system matrix on the hexahedral mesh (implies --hex) with sum
+  // factorization, --p1p1 to use PSPG stabilized P1/P1 elements, --supg to
+  // add SUPG to them and --grad-div to add the grad-div term with the
+  // augmented Lagrangian preconditioner (aSIMPLE with the stabilized
+  // elements)
+  std::string mesh_file_name = "../mesh/Cylinder2D.msh";
+  bool autotune = false;
+  bool recycle = false;
+  bool newton = false;
+  bool steady = false;
+  bool mixed_precision = false;
+  bool adaptive_tolerances = false;
+  bool low_synchronization = false;
+  bool shared_memory = false;
+  bool direct = false;
+  bool hex = false;
+  bool amr = false;
+  bool matrix_free = false;
+  bool p1p1 = false;
+  bool supg = false;
+  bool grad_div = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::string(argv[i]) == "--autotune")
+      autotune = true;
+    else if (std::string(argv[i]) == "--recycle")
+      recycle = true;
+    else if (std::string(argv[i]) == "--newton")
+      newton = true;
+    else if (std::string(argv[i]) == "--mixed-precision")
+      mixed_precision = true;
+    else if (std::string(argv[i]) == "--adaptive-tolerances")
+      adaptive_tolerances = true;
+    else if (std::string(argv[i]) == "--low-sync")
+      low_synchronization = true;
+    else if (std::string(argv[i]) == "--shared-memory")
+      shared_memory = true;
+    else if (std::string(argv[i]) == "--direct")
+      direct = true;
+    else if (std::string(argv[i]) == "--hex")
+      hex = true;
+    else if (std::string(argv[i]) == "--amr")
+      amr = true;
+    else if (std::string(argv[i]) == "--matrix-free")
+      hex = matrix_free = true;
+    else if (std::string(argv[i]) == "--p1p1")
+      p1p1 = true;
+    else if (std::string(argv[i]) == "--supg")
+      p1p1 = supg = true;
+    else if (std::string(argv[i]) == "--grad-div")
+      grad_div = true;
+    else if (std::string(argv[i]) == "--steady")
+    {
+      steady = true;
+      test_case = 1;
+    }
+    else
+      mesh_file_name = argv[i];
+  }
+
+  // The matrix-free operator is instantiated for Q2/Q1 only.
+  if (matrix_free && p1p1)
+  {
+    if (rank == 0)
+      std::cerr << "--matrix-free needs the Q2/Q1 elements, it cannot be combined with --p1p1 or --supg" << std::endl;
+    return -1;
+  }
 
-  // Using TAYLOR-HOOD ELEMENTS
-  const unsigned int degree_velocity = 2;
+  // Using TAYLOR-HOOD ELEMENTS, or stabilized equal order ones
+  const unsigned int degree_velocity = p1p1 ? 1 : 2;
   const unsigned int degree_pressure = 1;
 
   // Time variables
@@ -24,10 +100,41 @@ int main(int argc, char *argv[])
   dealii::Timer timer;
   // Start the timer
   timer.restart();
-  NavierStokes problem(mesh_file_name, degree_velocity, degree_pressure, T, deltat, test_case);
+  FlowPastCylinder<2> flow_past_cylinder(test_case);
+  NavierStokes<2> problem(flow_past_cylinder, mesh_file_name, degree_velocity, degree_pressure, T, deltat);
 
+  // aSIMPLE, or augmented Lagrangian with the grad-div term (its Schur
+  // complement approximation does not include the PSPG block)
+  problem.set_preconditioner_type(grad_div && !p1p1 ? 4 : 3);
+  if (newton || steady)
+    problem.set_nonlinear_solver(NavierStokes<2>::NonlinearSolver::newton);
+  if (direct)
+    problem.enable_direct_solver();
+  if (shared_memory)
+    problem.enable_shared_memory_ghosts();
+  if (hex)
+    problem.use_hex_mesh(2);
+  if (amr)
+    problem.enable_adaptive_refinement();
+  if (matrix_free)
+    problem.enable_matrix_free();
+  if (p1p1)
+    problem.enable_stabilization(supg);
+  if (grad_div)
+    problem.enable_grad_div();
   problem.setup();
-  problem.solve();
+  if (autotune)
+    problem.enable_autotuning();
+  if (recycle)
+    problem.enable_krylov_recycling();
+  problem.set_mixed_precision(mixed_precision);
+  problem.set_low_synchronization_solvers(low_synchronization);
+  if (adaptive_tolerances)
+    problem.enable_adaptive_tolerances();
+  if (steady)
+    problem.solve_steady();
+  else
+    problem.solve();
 
   // Stop the timer
   timer.stop();
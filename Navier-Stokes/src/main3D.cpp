@@ -1,4 +1,5 @@
-#include "../include/NavierStokes3D.hpp"
+#include "../include/NavierStokes.hpp"
+#include "../include/FlowPastCylinder.hpp"
 
 // Main function.
 int main(int argc, char *argv[])
@@ -28,10 +29,71 @@ int main(int argc, char *argv[])
   MPI_Bcast(&test_case, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
 
-  const std::string mesh_file_name = argc > 1 ? argv[1] : "../mesh/Parallelepiped3D.msh";
+  // Mesh File, pass --autotune to autotune the preconditioner, --recycle to
+  // recycle Krylov subspaces between the linear solves, --mixed-precision to
+  // use single precision inner preconditioners, --adaptive-tolerances to
+  // adapt the tolerances of the linear solves, --low-sync to use the low
+  // synchronization Krylov solvers, --shared-memory to share the ghost
+  // entries within a node, --p1p1 to use PSPG stabilized P1/P1 elements,
+  // --supg to add SUPG to them, --grad-div to add the grad-div term with
+  // the augmented Lagrangian preconditioner (aSIMPLE with the stabilized
+  // elements), --component-F to precondition
+  // F with one scalar factorization shared by the velocity components, --hex
+  // to solve on a Q2/Q1 hexahedral mesh (the mesh file is then not used) and
+  // --matrix-free to apply the system matrix on it with sum factorization
+  std::string mesh_file_name = "../mesh/Parallelepiped3D.msh";
+  bool autotune = false;
+  bool recycle = false;
+  bool mixed_precision = false;
+  bool adaptive_tolerances = false;
+  bool low_synchronization = false;
+  bool shared_memory = false;
+  bool p1p1 = false;
+  bool supg = false;
+  bool grad_div = false;
+  bool component_F = false;
+  bool hex = false;
+  bool matrix_free = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::string(argv[i]) == "--autotune")
+      autotune = true;
+    else if (std::string(argv[i]) == "--recycle")
+      recycle = true;
+    else if (std::string(argv[i]) == "--mixed-precision")
+      mixed_precision = true;
+    else if (std::string(argv[i]) == "--adaptive-tolerances")
+      adaptive_tolerances = true;
+    else if (std::string(argv[i]) == "--low-sync")
+      low_synchronization = true;
+    else if (std::string(argv[i]) == "--shared-memory")
+      shared_memory = true;
+    else if (std::string(argv[i]) == "--p1p1")
+      p1p1 = true;
+    else if (std::string(argv[i]) == "--supg")
+      p1p1 = supg = true;
+    else if (std::string(argv[i]) == "--grad-div")
+      grad_div = true;
+    else if (std::string(argv[i]) == "--component-F")
+      component_F = true;
+    else if (std::string(argv[i]) == "--hex")
+      hex = true;
+    else if (std::string(argv[i]) == "--matrix-free")
+      hex = matrix_free = true;
+    else
+      mesh_file_name = argv[i];
+  }
+
+  // The matrix-free operator is instantiated for Q2/Q1 only.
+  if (matrix_free && p1p1)
+  {
+    if (rank == 0)
+      std::cerr << "--matrix-free needs the Q2/Q1 elements, it cannot be combined with --p1p1 or --supg" << std::endl;
+    return -1;
+  }
 
-  // Taylor-Hood elements
-  const unsigned int degree_velocity = 2;
+  // Taylor-Hood elements, or stabilized equal order ones
+  const unsigned int degree_velocity = p1p1 ? 1 : 2;
   const unsigned int degree_pressure = 1;
 
   const double T = 4;  
@@ -41,9 +103,36 @@ int main(int argc, char *argv[])
   // Start the timer for solving the entire problem
   timer.restart();
 
-  NavierStokes problem(mesh_file_name, degree_velocity, degree_pressure, T, deltat, test_case); 
-
+  FlowPastCylinder<3> flow_past_cylinder(test_case);
+  NavierStokes<3> problem(flow_past_cylinder, mesh_file_name, degree_velocity, degree_pressure, T, deltat);
+
+  if (shared_memory)
+    problem.enable_shared_memory_ghosts();
+  if (hex)
+    problem.use_hex_mesh(1);
+  if (matrix_free)
+    problem.enable_matrix_free();
+  if (p1p1)
+    problem.enable_stabilization(supg);
+  if (component_F)
+    problem.enable_component_preconditioner();
+  if (grad_div)
+  {
+    problem.enable_grad_div();
+    // The Schur complement approximation of the augmented Lagrangian
+    // preconditioner does not include the PSPG block.
+    if (!p1p1)
+      problem.set_preconditioner_type(4);
+  }
   problem.setup();
+  if (autotune)
+    problem.enable_autotuning();
+  if (recycle)
+    problem.enable_krylov_recycling();
+  problem.set_mixed_precision(mixed_precision);
+  problem.set_low_synchronization_solvers(low_synchronization);
+  if (adaptive_tolerances)
+    problem.enable_adaptive_tolerances();
   problem.solve();
 
   // Stop the timer
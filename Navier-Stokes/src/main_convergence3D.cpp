@@ -1,5 +1,38 @@
-#include "../include/Convergence3D.hpp"
+#include "../include/NavierStokes.hpp"
+#include "../include/EthierSteinmann.hpp"
 #include <deal.II/base/convergence_table.h>
+#include <numeric>
+
+// Number of processes of each mesh, proportional to its number of cells
+// (h^-dim), with at least one process per mesh. The processes left by the
+// rounding go to the largest remainders.
+std::vector<unsigned int>
+split_processes(const std::vector<double> &h_vals, const unsigned int &n_processes)
+{
+  const unsigned int n_meshes = h_vals.size();
+  std::vector<double> weights(n_meshes);
+  for (unsigned int i = 0; i < n_meshes; ++i)
+    weights[i] = std::pow(1.0 / h_vals[i], 3);
+  const double total_weight = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+  const unsigned int n_free = n_processes - n_meshes;
+  std::vector<unsigned int> n_mesh_processes(n_meshes, 1);
+  std::vector<std::pair<double, unsigned int>> remainders(n_meshes);
+  unsigned int n_assigned = 0;
+  for (unsigned int i = 0; i < n_meshes; ++i)
+  {
+    const double share = n_free * weights[i] / total_weight;
+    n_mesh_processes[i] += static_cast<unsigned int>(share);
+    n_assigned += static_cast<unsigned int>(share);
+    remainders[i] = {share - std::floor(share), i};
+  }
+
+  std::sort(remainders.rbegin(), remainders.rend());
+  for (unsigned int k = 0; k < n_free - n_assigned; ++k)
+    ++n_mesh_processes[remainders[k].second];
+
+  return n_mesh_processes;
+}
 
 // Main function.
 int main(int argc, char *argv[])
@@ -8,65 +41,129 @@ int main(int argc, char *argv[])
 
   int rank;
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  const unsigned int n_processes = Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD);
 
    ConvergenceTable table;
 
+  // Pass --autotune to autotune the preconditioner on each mesh, --direct
+  // to solve the systems of the coarse meshes with a sparse direct solver and
+  // --concurrent to solve all the meshes at the same time, each on a group of
+  // processes proportional to its size
+  bool autotune = false;
+  bool direct = false;
+  bool concurrent = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::string(argv[i]) == "--autotune")
+      autotune = true;
+    else if (std::string(argv[i]) == "--direct")
+      direct = true;
+    else if (std::string(argv[i]) == "--concurrent")
+      concurrent = true;
+  }
+
   const std::vector<std::string> meshes = {
                                           "../mesh/mesh-cube-1.msh",
                                           "../mesh/mesh-cube-2.msh",
                                           "../mesh/mesh-cube-5.msh",
                                           "../mesh/mesh-cube-10.msh"
                                           };
+  // Meshes solved by the direct solver with --direct.
+  const unsigned int n_direct_meshes = 2;
   const std::vector<double>      h_vals = {1.0 / 1.25,
                                            1.0 / 2.5,
                                            1.0 / 5.0,
                                            1.0 / 10.0};
-  
-  
+
+
   //const std::string mesh_file_name = argc > 1 ? argv[1] : "../mesh/mesh-cube-5.msh";
 
-  //TAYLOR-HOOD 
+  //TAYLOR-HOOD
   const unsigned int degree_velocity = 2;
   const unsigned int degree_pressure = 1;
-  std::vector<double> errors_L2;
-  std::vector<double> errors_H1;
+  std::vector<double> errors_L2(meshes.size(), 0.0);
+  std::vector<double> errors_H1(meshes.size(), 0.0);
 
- 
-  const double T = 0.0003; 
+
+  const double T = 0.0003;
   const double deltat = 0.0004;
 
+  // Solve on the i-th mesh with the processes of the communicator, and store
+  // the errors (on all of them).
+  const auto solve_mesh = [&](const unsigned int &i, const MPI_Comm &mpi_communicator,
+                              const std::string &label) {
+    EthierSteinmann ethier_steinmann(label);
+    NavierStokes<3> problem(ethier_steinmann, meshes[i], degree_velocity, degree_pressure, T, deltat, mpi_communicator); //test3
+
+    if (direct && i < n_direct_meshes)
+      problem.enable_direct_solver();
+    problem.set_log_prefix(label.empty() ? "" : label + "_");
+    problem.setup();
+    if (autotune)
+      problem.enable_autotuning();
+    problem.solve();
+
+    errors_L2[i] = problem.compute_error(VectorTools::L2_norm);
+    errors_H1[i] = problem.compute_error(VectorTools::H1_norm);
+  };
 
   dealii::Timer timer;
   // Start the timer
   timer.restart();
 
-  std::ofstream convergence_file("convergence.csv");
-  convergence_file << "h,eL2,eH1" << std::endl;
-
-  for (unsigned int i = 0; i < meshes.size(); ++i){
-
-  NavierStokes problem(meshes[i], degree_velocity, degree_pressure, T, deltat); //test3
+  if (concurrent && n_processes >= meshes.size())
+  {
+    // Contiguous group of processes of this rank.
+    const std::vector<unsigned int> n_mesh_processes = split_processes(h_vals, n_processes);
+    unsigned int mesh_index = 0;
+    unsigned int first_rank = 0;
+    while (first_rank + n_mesh_processes[mesh_index] <= static_cast<unsigned int>(rank))
+      first_rank += n_mesh_processes[mesh_index++];
+
+    MPI_Comm mesh_comm;
+    MPI_Comm_split(MPI_COMM_WORLD, mesh_index, rank, &mesh_comm);
+    solve_mesh(mesh_index, mesh_comm, "-mesh" + std::to_string(mesh_index));
+    const bool mesh_root = Utilities::MPI::this_mpi_process(mesh_comm) == 0;
+    MPI_Comm_free(&mesh_comm);
+
+    // Errors of all the meshes on rank 0: each mesh contributes through the
+    // first process of its group.
+    if (!mesh_root)
+    {
+      errors_L2[mesh_index] = 0.0;
+      errors_H1[mesh_index] = 0.0;
+    }
+    errors_L2 = Utilities::MPI::sum(errors_L2, MPI_COMM_WORLD);
+    errors_H1 = Utilities::MPI::sum(errors_H1, MPI_COMM_WORLD);
+  }
+  else
+  {
+    if (concurrent && rank == 0)
+      std::cout << "Fewer processes than meshes: the meshes are solved one after the other." << std::endl;
 
-  problem.setup();
-  problem.solve();
- 
-  const double error_L2 = problem.compute_error(VectorTools::L2_norm);
-  const double error_H1 = problem.compute_error(VectorTools::H1_norm);
-      
-  table.add_value("h", h_vals[i]);
-  table.add_value("L2", error_L2);
-  table.add_value("H1", error_H1);
-      
+    for (unsigned int i = 0; i < meshes.size(); ++i)
+      solve_mesh(i, MPI_COMM_WORLD, "");
+  }
 
-  convergence_file << h_vals[i] << "," << error_L2<< ","  << error_H1 << std::endl;
   // Stop the timer
   timer.stop();
-
-}
+  const double wall_time = Utilities::MPI::max(timer.wall_time(), MPI_COMM_WORLD);
 
   if(rank == 0)
   {
-  std::cout << "Time taken to solve ENTIRE Navier Stokes problem: " << timer.wall_time() << " seconds" << std::endl;
+  std::ofstream convergence_file("convergence.csv");
+  convergence_file << "h,eL2,eH1" << std::endl;
+
+  for (unsigned int i = 0; i < meshes.size(); ++i)
+  {
+    table.add_value("h", h_vals[i]);
+    table.add_value("L2", errors_L2[i]);
+    table.add_value("H1", errors_H1[i]);
+
+    convergence_file << h_vals[i] << "," << errors_L2[i] << ","  << errors_H1[i] << std::endl;
+  }
+
+  std::cout << "Time taken to solve ENTIRE Navier Stokes problem: " << wall_time << " seconds" << std::endl;
   table.evaluate_all_convergence_rates(ConvergenceTable::reduction_rate_log2);
   table.set_scientific("L2", true);
   table.set_scientific("H1", true);